@@ -0,0 +1,548 @@
+/**************************************************************
+
+DESCRIPTION
+
+	This file defines CAsyncDispatcher, a queue with worker
+	threads that delivers event callbacks off the triggering
+	thread, and async_subscriber() to plug it into any event.
+
+	The queue sheds load CoDel-style: it measures how long each
+	item waited (sojourn time). Once the sojourn time has stayed
+	above target for a whole interval, the dispatcher enters the
+	shedding state and discards low-priority items at dequeue,
+	more often the longer the overload lasts (interval/sqrt(n)).
+	High-priority items are always delivered. Items with a
+	conflation key are shed, while shedding, whenever a newer item
+	with the same key is queued behind them, so the latest value
+	always arrives. A task posted with an on_shed callback gets
+	that callback run instead when it is shed, so owners that
+	track their queued work can release it. A task (or on_shed
+	callback) that throws is counted as failed; the worker
+	carries on with the next item.
+
+	post_after() queues a task once a delay has passed; idle
+	workers sleep until the earliest such deadline.
+
+	CAsyncBatcher delivers triggers to a batch-aware subscriber.
+	It tracks the arrival interval and the handler cost per item.
+	When the consumer keeps up, each trigger is delivered on its
+	own. Under load, it gathers up to max_batch items or waits
+	max_linger, whichever comes first; the wait is a post_after()
+	timer, so no worker is held while a batch fills. The chosen
+	batch sizes are visible in CBatchStats.
+
+**************************************************************/
+
+
+#ifndef __CAsyncDispatcher_h__
+#define __CAsyncDispatcher_h__
+
+#include "CEventStatsOps.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+enum class EAsyncPriority {
+    Low,    // may be shed under overload
+    High    // always delivered
+};
+
+struct CCoDelConfig {
+    std::chrono::microseconds target{5000};     // acceptable standing queue delay
+    std::chrono::microseconds interval{100000}; // how long delay must persist before shedding
+    bool enabled = true;
+};
+
+struct CAsyncStats {
+    std::atomic<unsigned long> enqueued{0};
+    std::atomic<unsigned long> delivered{0};
+    std::atomic<unsigned long> failed{0};       // tasks or on_shed callbacks that threw
+    std::atomic<unsigned long> shed_dropped{0};
+    std::atomic<unsigned long> shed_conflated{0};
+    std::atomic<unsigned long> max_sojourn_us{0};
+    std::atomic<unsigned long> depth{0};
+};
+
+class CAsyncDispatcher {
+public:
+    using Task = std::function<void()>;
+    static constexpr uint64_t kNoKey = 0;
+
+    explicit CAsyncDispatcher(size_t threads = 1, CCoDelConfig codel = CCoDelConfig())
+        : codel_(codel) {
+        if (threads == 0) threads = 1;
+        for (size_t i = 0; i < threads; ++i) {
+            workers_.emplace_back([this]() { work(); });
+        }
+    }
+
+    // Delivers what is queued (delayed tasks without further delay), then
+    // joins the workers.
+    ~CAsyncDispatcher() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        cv_.notify_all();
+        for (auto& worker : workers_) {
+            worker.join();
+        }
+    }
+
+    CAsyncDispatcher(const CAsyncDispatcher&) = delete;
+    CAsyncDispatcher& operator=(const CAsyncDispatcher&) = delete;
+
+    // key != kNoKey marks items that may be conflated with newer ones of the same key.
+    // on_shed (optional) runs on a worker in place of a task that was shed.
+    void post(Task task, EAsyncPriority priority = EAsyncPriority::Low, uint64_t key = kNoKey,
+              Task on_shed = nullptr) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            queue_.push_back(Item{std::move(task), Clock::now(), priority, key, std::move(on_shed)});
+            if (key != kNoKey) ++keyed_[key];
+            stats_.depth.store(queue_.size(), std::memory_order_relaxed);
+            if (shared_) {
+                sharedOps_->count_trigger(shared_);
+                sharedOps_->set_queue_depth(shared_, static_cast<int64_t>(queue_.size()));
+            }
+        }
+        stats_.enqueued.fetch_add(1, std::memory_order_relaxed);
+        cv_.notify_one();
+    }
+
+    // Queues task once delay has passed; its sojourn time counts from then.
+    void post_after(std::chrono::microseconds delay, Task task, EAsyncPriority priority = EAsyncPriority::Low,
+                    Task on_shed = nullptr) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            timers_.push_back(Timer{Clock::now() + delay, nextTimer_++,
+                                    Item{std::move(task), Clock::time_point(), priority, kNoKey, std::move(on_shed)}});
+            std::push_heap(timers_.begin(), timers_.end(), Later());
+        }
+        cv_.notify_all();   // a worker may need to wake earlier than it planned
+    }
+
+    const CAsyncStats& stats() const { return stats_; }
+
+    // Also publishes posts, queue depth, sheds and task run time to a
+    // shared-memory slot (see CEventStats.h); nullptr detaches.
+    template <typename Slot>
+    void set_stats(Slot* stats) {
+        static_assert(std::is_same<Slot, CEventStatsSlot>::value, "set_stats() takes a CEventStatsSlot");
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stats) {
+            stats->set_queue_depth(static_cast<int64_t>(queue_.size()));
+            sharedOps_ = CEventStatsOps::of<Slot>();
+        }
+        shared_ = stats;
+    }
+
+    void set_stats(std::nullptr_t) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        shared_ = nullptr;
+    }
+
+    bool shedding() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return dropping_;
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Item {
+        Task task;
+        Clock::time_point enqueued;
+        EAsyncPriority priority;
+        uint64_t key;
+        Task on_shed;
+    };
+
+    struct Timer {
+        Clock::time_point due;
+        uint64_t seq;
+        Item item;
+    };
+
+    // Min-heap on (due, seq)
+    struct Later {
+        bool operator()(const Timer& a, const Timer& b) const {
+            return a.due != b.due ? a.due > b.due : a.seq > b.seq;
+        }
+    };
+
+    // Moves delayed tasks that are due (all of them when stopping) into the queue.
+    void release_timers_locked(Clock::time_point now) {
+        while (!timers_.empty() && (stopping_ || timers_.front().due <= now)) {
+            std::pop_heap(timers_.begin(), timers_.end(), Later());
+            Item item = std::move(timers_.back().item);
+            item.enqueued = timers_.back().due;
+            timers_.pop_back();
+            queue_.push_back(std::move(item));
+        }
+        stats_.depth.store(queue_.size(), std::memory_order_relaxed);
+    }
+
+    void work() {
+        std::vector<Task> shed;         // destroyed outside the lock: captures may post again
+        std::vector<Task> onShed;
+        for (;;) {
+            Task task;
+            CEventStatsSlot* shared = nullptr;
+            const CEventStatsOps* ops = nullptr;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                for (;;) {
+                    release_timers_locked(Clock::now());
+                    if (queue_.empty()) {
+                        if (!shed.empty()) break;
+                        if (stopping_) return;
+                        if (timers_.empty()) cv_.wait(lock);
+                        else cv_.wait_until(lock, timers_.front().due);
+                        continue;
+                    }
+                    Item item = std::move(queue_.front());
+                    queue_.pop_front();
+                    stats_.depth.store(queue_.size(), std::memory_order_relaxed);
+                    if (shared_) sharedOps_->set_queue_depth(shared_, static_cast<int64_t>(queue_.size()));
+                    bool superseded = false;
+                    if (item.key != kNoKey) {
+                        auto it = keyed_.find(item.key);
+                        superseded = --it->second > 0;
+                        if (it->second == 0) keyed_.erase(it);
+                    }
+                    if (!should_shed(item, superseded, Clock::now())) {
+                        task = std::move(item.task);
+                        shared = shared_;
+                        ops = sharedOps_;
+                        break;
+                    }
+                    if (shared_) sharedOps_->count_drop(shared_);
+                    shed.push_back(std::move(item.task));
+                    if (item.on_shed) onShed.push_back(std::move(item.on_shed));
+                }
+            }
+            shed.clear();
+            for (auto& callback : onShed) run(callback);
+            onShed.clear();
+            if (!task) continue;
+            uint64_t start = shared ? CEventStatsOps::now_ns() : 0;
+            bool ok = run(task);
+            if (shared) ops->record_latency(shared, CEventStatsOps::now_ns() - start);
+            if (ok) stats_.delivered.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    // An exception must not unwind the worker thread.
+    bool run(Task& task) {
+        try {
+            task();
+            return true;
+        } catch (...) {
+            stats_.failed.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+    }
+
+    // CoDel control law, evaluated per dequeued item under mutex_.
+    bool should_shed(const Item& item, bool superseded, Clock::time_point now) {
+        auto sojourn = std::chrono::duration_cast<std::chrono::microseconds>(now - item.enqueued);
+        unsigned long us = static_cast<unsigned long>(sojourn.count());
+        if (us > stats_.max_sojourn_us.load(std::memory_order_relaxed)) {
+            stats_.max_sojourn_us.store(us, std::memory_order_relaxed);
+        }
+        if (!codel_.enabled) return false;
+
+        if (sojourn < codel_.target || queue_.empty()) {
+            firstAboveTime_ = Clock::time_point();
+            dropping_ = false;
+            return false;
+        }
+        if (firstAboveTime_ == Clock::time_point()) {
+            firstAboveTime_ = now + codel_.interval;
+            return false;
+        }
+        if (!dropping_) {
+            if (now < firstAboveTime_) return false;
+            dropping_ = true;
+            // Resume near the previous drop rate if overload returned quickly.
+            dropCount_ = (dropCount_ > 2 && now - dropNext_ < 16 * codel_.interval) ? dropCount_ - 2 : 1;
+            dropNext_ = now;
+        }
+        if (item.priority == EAsyncPriority::High) return false;
+
+        // A superseded update carries nothing the newer one lacks: always shed
+        // it while overloaded. Everything else follows the drop schedule.
+        if (item.key != kNoKey) {
+            if (superseded) stats_.shed_conflated.fetch_add(1, std::memory_order_relaxed);
+            return superseded;
+        }
+        if (now < dropNext_) return false;
+
+        ++dropCount_;
+        dropNext_ = now + std::chrono::duration_cast<Clock::duration>(
+            codel_.interval / std::sqrt(static_cast<double>(dropCount_)));
+        stats_.shed_dropped.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    CCoDelConfig codel_;
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<Item> queue_;
+    std::unordered_map<uint64_t, unsigned int> keyed_;  // queued items per conflation key
+    std::vector<Timer> timers_;                         // post_after() tasks not yet due
+    uint64_t nextTimer_ = 0;
+    bool stopping_ = false;
+
+    // CoDel state
+    Clock::time_point firstAboveTime_;
+    Clock::time_point dropNext_;
+    unsigned int dropCount_ = 0;
+    bool dropping_ = false;
+
+    CAsyncStats stats_;
+    CEventStatsSlot* shared_ = nullptr;     // guarded by mutex_
+    const CEventStatsOps* sharedOps_ = nullptr;
+    std::vector<std::thread> workers_;
+};
+
+template <typename... Args>
+struct CAsyncCallback {
+    using Callback = std::function<void(Args...)>;
+    using KeyOf = std::function<uint64_t(const std::decay_t<Args>&...)>;
+};
+
+// Callback that hands each trigger to dispatcher instead of running it inline.
+// keyOf (optional) maps the arguments to a conflation key.
+template <typename... Args>
+std::function<void(Args...)> async_subscriber(CAsyncDispatcher& dispatcher,
+        typename CAsyncCallback<Args...>::Callback callback,
+        EAsyncPriority priority = EAsyncPriority::Low,
+        typename CAsyncCallback<Args...>::KeyOf keyOf = nullptr) {
+    auto shared = std::make_shared<std::function<void(Args...)>>(std::move(callback));
+    return [&dispatcher, shared, priority, keyOf](Args... args) {
+        uint64_t key = keyOf ? keyOf(args...) : CAsyncDispatcher::kNoKey;
+        dispatcher.post([shared, stored = std::tuple<std::decay_t<Args>...>(args...)]() {
+            std::apply(*shared, stored);
+        }, priority, key);
+    };
+}
+
+struct CBatchConfig {
+    size_t max_batch = 64;
+    std::chrono::microseconds max_linger{1000};    // longest wait for a batch to fill
+};
+
+struct CBatchStats {
+    static constexpr size_t kBuckets = 8;           // batch sizes 1, 2-3, 4-7, ..., 128+
+
+    std::atomic<unsigned long> batches{0};
+    std::atomic<unsigned long> items{0};
+    std::atomic<unsigned long> target_batch{1};     // size the batcher is currently aiming for
+    std::atomic<unsigned long> dropped{0};          // items lost with a shed deliver task
+    std::atomic<unsigned long> size_histogram[kBuckets] = {};
+
+    void record(size_t size) {
+        batches.fetch_add(1, std::memory_order_relaxed);
+        items.fetch_add(size, std::memory_order_relaxed);
+        size_t bucket = 0;
+        while (bucket + 1 < kBuckets && (size_t(2) << bucket) <= size) ++bucket;
+        size_histogram[bucket].fetch_add(1, std::memory_order_relaxed);
+    }
+};
+
+template <typename... Args>
+class CAsyncBatcher : public std::enable_shared_from_this<CAsyncBatcher<Args...>> {
+public:
+    using Batch = std::vector<std::tuple<std::decay_t<Args>...>>;
+    using BatchCallback = std::function<void(const Batch&)>;
+
+    CAsyncBatcher(CAsyncDispatcher& dispatcher, BatchCallback callback,
+                  CBatchConfig config = CBatchConfig(), EAsyncPriority priority = EAsyncPriority::Low)
+        : dispatcher_(dispatcher), callback_(std::move(callback)), config_(config), priority_(priority) {
+        if (config_.max_batch == 0) config_.max_batch = 1;
+    }
+
+    // Callback to subscribe with; it keeps the batcher alive.
+    std::function<void(Args...)> callback() {
+        auto self = this->shared_from_this();
+        return [self](Args... args) { self->push(args...); };
+    }
+
+    void push(Args... args) {
+        bool post = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto now = Clock::now();
+            if (lastArrival_ != Clock::time_point()) {
+                ewma(arrivalNs_, static_cast<double>((now - lastArrival_).count()));
+            }
+            lastArrival_ = now;
+            if (pending_.empty()) firstPending_ = now;
+            pending_.emplace_back(args...);
+            // A lingering batch that has filled up goes now rather than at the timer.
+            if (state_ == State::Idle || (state_ == State::Lingering && pending_.size() >= lingerTarget_)) {
+                state_ = State::Posted;
+                post = true;
+            }
+        }
+        if (post) post_deliver();
+    }
+
+    const CBatchStats& stats() const { return stats_; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    enum class State {
+        Idle,       // nothing queued for this batcher
+        Posted,     // one deliver() task is queued or running
+        Lingering,  // a linger timer is armed; no deliver() task is queued
+    };
+
+    static void ewma(double& avg, double sample) {
+        avg = avg == 0 ? sample : avg + (sample - avg) / 8;
+    }
+
+    // Idle consumer: one by one. Busy consumer: as many as arrive within max_linger.
+    size_t target_locked() const {
+        if (arrivalNs_ == 0 || costNs_ < arrivalNs_ / 2) return 1;
+        double linger = static_cast<double>(std::chrono::nanoseconds(config_.max_linger).count());
+        size_t expected = static_cast<size_t>(linger / std::max(arrivalNs_, 1.0));
+        return std::max<size_t>(1, std::min(config_.max_batch, expected));
+    }
+
+    // state_ is Posted.
+    void post_deliver() {
+        auto self = this->shared_from_this();
+        dispatcher_.post([self]() { self->deliver(); }, priority_, CAsyncDispatcher::kNoKey,
+                         [self]() { self->shed(); });
+    }
+
+    // Runs on a dispatcher worker with state_ == Posted; state_ stays Posted
+    // until the batch has been handled and the next step decided.
+    void deliver() {
+        Batch batch;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            size_t target = target_locked();
+            stats_.target_batch.store(target, std::memory_order_relaxed);
+            auto deadline = firstPending_ + config_.max_linger;
+            auto now = Clock::now();
+            if (pending_.size() < target && now < deadline) {
+                state_ = State::Lingering;
+                lingerTarget_ = target;
+                uint64_t generation = ++lingerGeneration_;
+                auto self = this->shared_from_this();
+                dispatcher_.post_after(std::chrono::duration_cast<std::chrono::microseconds>(deadline - now),
+                                       [self, generation]() { self->linger_expired(generation, false); },
+                                       priority_, [self, generation]() { self->linger_expired(generation, true); });
+                return;
+            }
+            size_t take = std::min(pending_.size(), config_.max_batch);
+            batch.assign(std::make_move_iterator(pending_.begin()),
+                         std::make_move_iterator(pending_.begin() + take));
+            pending_.erase(pending_.begin(), pending_.begin() + take);
+            if (!pending_.empty()) firstPending_ = now;
+        }
+
+        double perItem = -1;
+        if (!batch.empty()) {
+            auto start = Clock::now();
+            callback_(batch);
+            perItem = static_cast<double>((Clock::now() - start).count()) / batch.size();
+            stats_.record(batch.size());
+        }
+        finish(perItem);
+    }
+
+    // The linger timer fired (or was shed); stale if the batch already went.
+    void linger_expired(uint64_t generation, bool wasShed) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (state_ != State::Lingering || generation != lingerGeneration_) return;
+            state_ = State::Posted;
+        }
+        if (wasShed) shed();
+        else deliver();
+    }
+
+    // The dispatcher shed a deliver() task: the oldest batch is dropped with it.
+    void shed() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            size_t drop = std::min(pending_.size(), config_.max_batch);
+            pending_.erase(pending_.begin(), pending_.begin() + drop);
+            if (!pending_.empty()) firstPending_ = Clock::now();
+            stats_.dropped.fetch_add(drop, std::memory_order_relaxed);
+        }
+        finish(-1);
+    }
+
+    // Ends a Posted step: reposts while items are pending, else goes idle.
+    void finish(double perItem) {
+        bool repost = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (perItem >= 0) ewma(costNs_, perItem);
+            if (pending_.empty()) state_ = State::Idle;
+            else repost = true;
+        }
+        if (repost) post_deliver();
+    }
+
+    CAsyncDispatcher& dispatcher_;
+    BatchCallback callback_;
+    CBatchConfig config_;
+    EAsyncPriority priority_;
+
+    std::mutex mutex_;
+    Batch pending_;
+    State state_ = State::Idle;
+    size_t lingerTarget_ = 1;           // Lingering: size at which the batch goes early
+    uint64_t lingerGeneration_ = 0;     // tells the current linger timer from stale ones
+    Clock::time_point firstPending_;
+    Clock::time_point lastArrival_;
+    double arrivalNs_ = 0;              // EWMA of the time between pushes
+    double costNs_ = 0;                 // EWMA of handler time per item
+
+    CBatchStats stats_;
+};
+
+// usage example
+/*
+CAsyncDispatcher guiQueue(1);   // CoDel: 5 ms target, 100 ms interval
+
+auto onStatus = std::make_shared<CEventSafe<int, std::string>>();
+auto sub = onStatus->subscribe(async_subscriber<int, std::string>(guiQueue,
+    [](int dev, std::string text) { gui.show(dev, text); },
+    EAsyncPriority::Low,
+    [](const int& dev, const std::string&) { return static_cast<uint64_t>(dev) + 1; }));
+
+// under overload, stale per-device updates are conflated away
+std::cout << guiQueue.stats().shed_conflated << " shed" << std::endl;
+
+// batch-aware subscriber: one DB transaction per batch
+auto writer = std::make_shared<CAsyncBatcher<int, std::string>>(guiQueue,
+    [](const CAsyncBatcher<int, std::string>::Batch& rows) { db.insert_all(rows); },
+    CBatchConfig{256, std::chrono::microseconds(2000)});
+auto dbSub = onStatus->subscribe(writer->callback());
+std::cout << "aiming for " << writer->stats().target_batch << " per batch" << std::endl;
+*/
+
+#endif
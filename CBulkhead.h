@@ -0,0 +1,285 @@
+/**************************************************************
+
+DESCRIPTION
+
+	This file defines per-subscriber concurrency limits and named
+	bulkhead pools for asynchronous subscribers.
+
+	CConcurrencyLimiter sits between an event and an executor (a
+	CThreadPool or a CAsyncDispatcher). It runs at most
+	max_concurrent calls of its subscriber at once. Triggers over
+	the limit wait in the limiter's own bounded queue rather than
+	in the executor's queue. A slow subscriber therefore holds at
+	most max_concurrent threads, and cannot fill the shared queue
+	ahead of faster subscribers.
+
+	Each launched call carries a permit. If the executor drops the
+	call (a pool that is gone, a dispatcher that sheds it), the
+	permit passes to the next waiting trigger and the call counts
+	as dropped. A subscriber that throws counts as failed; the
+	exception does not reach the executor's thread.
+
+	CBulkheadRegistry keeps named CThreadPools, each with its own
+	threads and queue, so slow subscribers can be moved off the
+	pool that fast ones use.
+
+**************************************************************/
+
+
+#ifndef __CBulkhead_h__
+#define __CBulkhead_h__
+
+#include "CAsyncDispatcher.h"
+#include "CThreadPool.h"
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+
+struct CConcurrencyLimit {
+    unsigned int max_concurrent = 1;
+    size_t max_queued = 1024;   // waiting triggers beyond this are dropped
+};
+
+template <typename... Args>
+class CConcurrencyLimiter : public std::enable_shared_from_this<CConcurrencyLimiter<Args...>> {
+public:
+    using Callback = std::function<void(Args...)>;
+    using Post = std::function<void(std::function<void()>)>;
+
+    CConcurrencyLimiter(Post post, Callback callback, CConcurrencyLimit limit = CConcurrencyLimit())
+        : post_(std::move(post)), callback_(std::move(callback)), limit_(limit) {
+        if (limit_.max_concurrent == 0) limit_.max_concurrent = 1;
+    }
+
+    // Runs on pool; the limiter does not keep the pool alive. name (a literal)
+    // is what a watchdog on the pool reports.
+    CConcurrencyLimiter(const std::shared_ptr<CThreadPool>& pool, Callback callback,
+                        CConcurrencyLimit limit = CConcurrencyLimit(), const char* name = nullptr)
+        : CConcurrencyLimiter(pool_post(pool, name), std::move(callback), limit) {}
+
+    // Runs on dispatcher, which must outlive the limiter.
+    CConcurrencyLimiter(CAsyncDispatcher& dispatcher, Callback callback,
+                        CConcurrencyLimit limit = CConcurrencyLimit(),
+                        EAsyncPriority priority = EAsyncPriority::Low)
+        : CConcurrencyLimiter([&dispatcher, priority](std::function<void()> task) {
+              dispatcher.post(std::move(task), priority);
+          }, std::move(callback), limit) {}
+
+    // Callback to subscribe with; it keeps the limiter alive.
+    Callback callback() {
+        auto self = this->shared_from_this();
+        return [self](Args... args) { self->invoke(args...); };
+    }
+
+    void invoke(Args... args) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (inFlight_ >= limit_.max_concurrent) {
+                if (waiting_.size() < limit_.max_queued) {
+                    waiting_.emplace_back(args...);
+                } else {
+                    dropped_.fetch_add(1, std::memory_order_relaxed);
+                }
+                return;
+            }
+            ++inFlight_;
+        }
+        launch(Stored(args...));
+    }
+
+    unsigned int in_flight() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return inFlight_;
+    }
+
+    size_t queued() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return waiting_.size();
+    }
+
+    unsigned long delivered() const { return delivered_.load(std::memory_order_relaxed); }
+    unsigned long dropped() const { return dropped_.load(std::memory_order_relaxed); }
+    unsigned long failed() const { return failed_.load(std::memory_order_relaxed); }
+
+private:
+    using Stored = std::tuple<std::decay_t<Args>...>;
+
+    // One inFlight_ permit, shared by the copies of a launched task. run()
+    // releases it; if the executor destroys the task unrun, the last copy does.
+    class Permit {
+    public:
+        explicit Permit(std::shared_ptr<CConcurrencyLimiter> owner) : owner_(std::move(owner)) {}
+
+        ~Permit() {
+            if (!owner_) return;
+            owner_->dropped_.fetch_add(1, std::memory_order_relaxed);
+            release();
+        }
+
+        Permit(const Permit&) = delete;
+        Permit& operator=(const Permit&) = delete;
+
+        void release() {
+            std::shared_ptr<CConcurrencyLimiter> owner = std::move(owner_);
+            owner->hand_off();
+        }
+
+    private:
+        std::shared_ptr<CConcurrencyLimiter> owner_;
+    };
+
+    static Post pool_post(const std::shared_ptr<CThreadPool>& pool, const char* name) {
+        std::weak_ptr<CThreadPool> weakPool = pool;
+        return [weakPool, name](std::function<void()> task) {
+            if (auto pool = weakPool.lock()) pool->submit(std::move(task), name);
+        };
+    }
+
+    void launch(Stored stored) {
+        auto self = this->shared_from_this();
+        auto permit = std::make_shared<Permit>(self);
+        post_([self, permit, stored = std::move(stored)]() mutable { self->run(*permit, std::move(stored)); });
+    }
+
+    void run(Permit& permit, Stored stored) {
+        try {
+            std::apply(callback_, stored);
+            delivered_.fetch_add(1, std::memory_order_relaxed);
+        } catch (...) {
+            failed_.fetch_add(1, std::memory_order_relaxed);
+        }
+        permit.release();
+    }
+
+    // A released permit goes to the next waiting trigger, which goes to the
+    // back of the executor queue so other subscribers get a turn. A post the
+    // executor drops (or runs) on the spot releases its permit inside post_;
+    // that release is counted on this thread's frame and looped here, so a
+    // long queue of dropped triggers does not recurse through ~Permit.
+    void hand_off() {
+        struct Frame {
+            CConcurrencyLimiter* owner;
+            unsigned long pending;
+            Frame* previous;
+        };
+        static thread_local Frame* active = nullptr;
+        if (active && active->owner == this) {
+            ++active->pending;
+            return;
+        }
+        Frame frame{this, 1, active};
+        struct Restore {
+            Frame& frame;
+            ~Restore() { active = frame.previous; }
+        } restore{frame};
+        active = &frame;
+
+        while (frame.pending > 0) {
+            --frame.pending;
+            std::optional<Stored> stored;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (waiting_.empty()) {
+                    --inFlight_;
+                    continue;
+                }
+                stored.emplace(std::move(waiting_.front()));
+                waiting_.pop_front();
+            }
+            launch(std::move(*stored));
+        }
+    }
+
+    Post post_;
+    Callback callback_;
+    CConcurrencyLimit limit_;
+
+    mutable std::mutex mutex_;
+    unsigned int inFlight_ = 0;
+    std::deque<Stored> waiting_;
+    std::atomic<unsigned long> delivered_{0};
+    std::atomic<unsigned long> dropped_{0};
+    std::atomic<unsigned long> failed_{0};
+};
+
+class CBulkheadRegistry {
+public:
+    static CBulkheadRegistry& instance() {
+        static CBulkheadRegistry registry;
+        return registry;
+    }
+
+    // Creates pool `name` with threads workers, or returns it if it exists.
+    std::shared_ptr<CThreadPool> define(const std::string& name, size_t threads,
+                                        std::shared_ptr<IPoolWatchdog> watchdog = nullptr) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto& pool = pools_[name];
+        if (!pool) pool = std::make_shared<CThreadPool>(threads, std::move(watchdog));
+        return pool;
+    }
+
+    // nullptr if no pool of that name was defined.
+    std::shared_ptr<CThreadPool> get(const std::string& name) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = pools_.find(name);
+        return it != pools_.end() ? it->second : nullptr;
+    }
+
+    // The pool drains and joins once its last user lets go.
+    void remove(const std::string& name) {
+        std::shared_ptr<CThreadPool> pool;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = pools_.find(name);
+            if (it == pools_.end()) return;
+            pool = std::move(it->second);
+            pools_.erase(it);
+        }
+    }
+
+private:
+    mutable std::mutex mutex_;
+    std::map<std::string, std::shared_ptr<CThreadPool>> pools_;
+};
+
+// Shorthand: event->subscribe(bulkhead_subscriber<std::string>("slow", cb, {2}));
+// Runs callback on bulkhead pool `pool_name` (which must be defined), at most
+// limit.max_concurrent at a time. Throws std::invalid_argument if the pool does
+// not exist, rather than handing subscribe() an empty callback.
+template <typename... Args>
+std::function<void(Args...)> bulkhead_subscriber(const std::string& pool_name,
+        typename CConcurrencyLimiter<Args...>::Callback callback,
+        CConcurrencyLimit limit = CConcurrencyLimit(), const char* name = nullptr) {
+    auto pool = CBulkheadRegistry::instance().get(pool_name);
+    if (!pool) throw std::invalid_argument("bulkhead_subscriber: no pool named " + pool_name);
+    return std::make_shared<CConcurrencyLimiter<Args...>>(pool, std::move(callback), limit, name)->callback();
+}
+
+// usage example
+/*
+auto& bulkheads = CBulkheadRegistry::instance();
+bulkheads.define("fast", 4);
+bulkheads.define("plugins", 2);        // slow third-party code is boxed in here
+
+auto onStatus = std::make_shared<CEventSafe<std::string>>();
+auto guiSub = onStatus->subscribe(bulkhead_subscriber<std::string>("fast",
+    [](std::string info) { gui.show(info); }, CConcurrencyLimit{4}));
+auto pluginSub = onStatus->subscribe(bulkhead_subscriber<std::string>("plugins",
+    [](std::string info) { plugin.OnStatus(info); }, CConcurrencyLimit{1, 256}, "plugin.OnStatus"));
+
+// or limit a subscriber on a shared dispatcher
+CAsyncDispatcher shared(8);
+auto limiter = std::make_shared<CConcurrencyLimiter<std::string>>(shared,
+    [](std::string info) { archive.store(info); }, CConcurrencyLimit{2});
+auto archiveSub = onStatus->subscribe(limiter->callback());
+*/
+
+#endif
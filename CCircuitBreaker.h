@@ -0,0 +1,266 @@
+/**************************************************************
+
+DESCRIPTION
+
+	This file defines CCircuitBreaker and circuit_guarded(), an
+	opt-in guard that stops one misbehaving subscriber from
+	degrading the whole fan-out of an event.
+
+	The guarded callback catches everything its subscriber
+	throws, so the remaining handlers of the trigger still run.
+	Each call is recorded as ok, failed (threw) or slow (over the
+	latency budget). When enough calls in the current window went
+	wrong, the breaker opens. The subscriber is then skipped until
+	the cooldown ends. After that, a few probe calls are let
+	through (half-open). If they succeed the breaker closes,
+	otherwise it opens again.
+
+	Counters live in CCircuitStats. The guard can also publish to
+	a CEventStatsSlot (CEventStats.h): calls and latency go there,
+	and skipped calls are counted as drops.
+
+**************************************************************/
+
+
+#ifndef __CCircuitBreaker_h__
+#define __CCircuitBreaker_h__
+
+#include "CEventStats.h"
+
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+enum class ECircuitState {
+    Closed,     // calls go through
+    Open,       // calls are skipped until the cooldown ends
+    HalfOpen    // a few probe calls decide whether to close again
+};
+
+struct CCircuitConfig {
+    double failure_ratio = 0.5;                     // trip when this share of calls threw...
+    double slow_ratio = 0.5;                        // ...or this share overran the budget
+    unsigned int min_calls = 20;                    // calls in the window before tripping is considered
+    std::chrono::milliseconds window{10000};        // counts restart every window
+    std::chrono::microseconds latency_budget{0};    // 0 disables the latency check
+    std::chrono::milliseconds cooldown{5000};
+    unsigned int probes = 1;                        // good half-open calls needed to close
+    std::function<void(ECircuitState)> on_state_change;
+    std::function<void(std::exception_ptr)> on_error;   // sees what the subscriber threw
+};
+
+struct CCircuitStats {
+    std::atomic<unsigned long> calls{0};
+    std::atomic<unsigned long> failures{0};
+    std::atomic<unsigned long> slow{0};
+    std::atomic<unsigned long> skipped{0};
+    std::atomic<unsigned long> trips{0};
+};
+
+class CCircuitBreaker {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit CCircuitBreaker(CCircuitConfig config = CCircuitConfig()) : config_(std::move(config)) {
+        if (config_.probes == 0) config_.probes = 1;
+    }
+
+    // Whether the next call may run; every true must be followed by record().
+    bool allow() {
+        ECircuitState state = state_.load(std::memory_order_acquire);
+        if (state == ECircuitState::Closed) return true;
+        bool changed = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto now = Clock::now();
+            if (state_ == ECircuitState::Open) {
+                if (now - openedAt_ < config_.cooldown) {
+                    stats_.skipped.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                }
+                set_state(ECircuitState::HalfOpen);
+                probesInFlight_ = 0;
+                probesPassed_ = 0;
+                changed = true;
+            }
+            if (state_ == ECircuitState::HalfOpen) {
+                if (probesInFlight_ + probesPassed_ >= config_.probes) {
+                    stats_.skipped.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                }
+                ++probesInFlight_;
+            }
+        }
+        if (changed) notify(ECircuitState::HalfOpen);
+        return true;
+    }
+
+    void record(bool failed, bool slow) {
+        stats_.calls.fetch_add(1, std::memory_order_relaxed);
+        if (failed) stats_.failures.fetch_add(1, std::memory_order_relaxed);
+        if (slow) stats_.slow.fetch_add(1, std::memory_order_relaxed);
+
+        ECircuitState changedTo = ECircuitState::Closed;
+        bool changed = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto now = Clock::now();
+            if (state_ == ECircuitState::HalfOpen) {
+                if (probesInFlight_ > 0) --probesInFlight_;
+                if (failed || slow) {
+                    trip(now);
+                    changed = true;
+                    changedTo = ECircuitState::Open;
+                } else if (++probesPassed_ >= config_.probes) {
+                    set_state(ECircuitState::Closed);
+                    reset_window(now);
+                    changed = true;
+                }
+            } else if (state_ == ECircuitState::Closed) {
+                if (now - windowStart_ >= config_.window) reset_window(now);
+                ++windowCalls_;
+                if (failed) ++windowFailures_;
+                if (slow) ++windowSlow_;
+                if (windowCalls_ >= config_.min_calls &&
+                    (windowFailures_ >= config_.failure_ratio * windowCalls_ ||
+                     (config_.latency_budget.count() > 0 && windowSlow_ >= config_.slow_ratio * windowCalls_))) {
+                    trip(now);
+                    changed = true;
+                    changedTo = ECircuitState::Open;
+                }
+            }
+            // Open: a call admitted before the trip finished late; nothing to decide.
+        }
+        if (changed) notify(changedTo);
+    }
+
+    ECircuitState state() const { return state_.load(std::memory_order_acquire); }
+    const CCircuitStats& stats() const { return stats_; }
+    const CCircuitConfig& config() const { return config_; }
+
+    // Forces the breaker closed, e.g. after the plug-in was fixed or reloaded.
+    void reset() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            set_state(ECircuitState::Closed);
+            reset_window(Clock::now());
+        }
+        notify(ECircuitState::Closed);
+    }
+
+private:
+    // Callers hold mutex_.
+    void set_state(ECircuitState state) { state_.store(state, std::memory_order_release); }
+
+    void trip(Clock::time_point now) {
+        set_state(ECircuitState::Open);
+        openedAt_ = now;
+        stats_.trips.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void reset_window(Clock::time_point now) {
+        windowStart_ = now;
+        windowCalls_ = windowFailures_ = windowSlow_ = 0;
+    }
+
+    void notify(ECircuitState state) {
+        if (config_.on_state_change) config_.on_state_change(state);
+    }
+
+    CCircuitConfig config_;
+    CCircuitStats stats_;
+    std::atomic<ECircuitState> state_{ECircuitState::Closed};
+
+    std::mutex mutex_;
+    Clock::time_point windowStart_ = Clock::now();
+    unsigned int windowCalls_ = 0;
+    unsigned int windowFailures_ = 0;
+    unsigned int windowSlow_ = 0;
+    Clock::time_point openedAt_;
+    unsigned int probesInFlight_ = 0;
+    unsigned int probesPassed_ = 0;
+};
+
+template <typename... Args>
+class CCircuitGuard : public std::enable_shared_from_this<CCircuitGuard<Args...>> {
+public:
+    using Callback = std::function<void(Args...)>;
+
+    CCircuitGuard(Callback callback, CCircuitConfig config = CCircuitConfig(), CEventStatsSlot* stats = nullptr)
+        : callback_(std::move(callback)), breaker_(std::move(config)), stats_(stats) {}
+
+    // Callback to subscribe with; it keeps the guard alive.
+    Callback callback() {
+        auto self = this->shared_from_this();
+        return [self](Args... args) { self->invoke(args...); };
+    }
+
+    // Never throws: the subscriber's exceptions go to on_error and the breaker.
+    void invoke(Args... args) {
+        if (!breaker_.allow()) {
+            if (stats_) stats_->count_drop();
+            return;
+        }
+        auto start = CCircuitBreaker::Clock::now();
+        bool failed = false;
+        try {
+            callback_(args...);
+        } catch (...) {
+            failed = true;
+            if (breaker_.config().on_error) {
+                try {
+                    breaker_.config().on_error(std::current_exception());
+                } catch (...) {
+                    // A throwing on_error must not skip record() and strand a probe.
+                }
+            }
+        }
+        auto elapsed = CCircuitBreaker::Clock::now() - start;
+        bool slow = breaker_.config().latency_budget.count() > 0 && elapsed > breaker_.config().latency_budget;
+        if (stats_) {
+            stats_->count_trigger();
+            stats_->record_latency(static_cast<uint64_t>(std::chrono::nanoseconds(elapsed).count()));
+        }
+        breaker_.record(failed, slow);
+    }
+
+    CCircuitBreaker& breaker() { return breaker_; }
+
+private:
+    Callback callback_;
+    CCircuitBreaker breaker_;
+    CEventStatsSlot* stats_;
+};
+
+// Shorthand: event->subscribe(circuit_guarded<std::string>(cb, config));
+template <typename... Args>
+std::function<void(Args...)> circuit_guarded(typename CCircuitGuard<Args...>::Callback callback,
+        CCircuitConfig config = CCircuitConfig(), CEventStatsSlot* stats = nullptr) {
+    return std::make_shared<CCircuitGuard<Args...>>(std::move(callback), std::move(config), stats)->callback();
+}
+
+// usage example
+/*
+auto onStatus = std::make_shared<CEventSafe<std::string>>();
+
+CCircuitConfig config;
+config.latency_budget = std::chrono::milliseconds(2);
+config.cooldown = std::chrono::seconds(30);
+config.on_state_change = [](ECircuitState state) {
+    if (state == ECircuitState::Open) g_pLog->LogInfo(LOG_SYS, "plugin disabled for 30 s");
+};
+
+auto plugin = std::make_shared<CCircuitGuard<std::string>>(
+    [](std::string info) { thirdParty.OnStatus(info); }, config);
+auto pluginSub = onStatus->subscribe(plugin->callback());
+
+// throws and slow calls no longer cost the GUI subscriber anything
+auto guiSub = onStatus->subscribe([](std::string info) { gui.show(info); });
+
+std::cout << plugin->breaker().stats().trips << " trips" << std::endl;
+*/
+
+#endif
@@ -0,0 +1,279 @@
+/**************************************************************
+
+DESCRIPTION
+
+	This file defines CCollectEvent, a thread-safe event whose
+	subscribers return a value, and the reducers used to combine
+	those values in trigger_collect().
+
+	A reducer provides
+	    Result init() const;                  // identity
+	    void combine(Result&, R value) const; // fold one reply
+	    void merge(Result&, Result) const;    // join two partials, left first
+	    bool done(const Result&) const;       // true to skip the rest
+	trigger_collect_parallel() splits the subscribers into chunks,
+	folds each chunk on the pool and merges the partial results
+	pairwise as a tree, keeping subscription order.
+
+**************************************************************/
+
+
+#ifndef __CCollectEvent_h__
+#define __CCollectEvent_h__
+
+#include "CThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+template <typename R>
+struct CReduceSum {
+    using Result = R;
+    Result init() const { return R{}; }
+    void combine(Result& acc, R value) const { acc += value; }
+    void merge(Result& acc, Result other) const { acc += other; }
+    bool done(const Result&) const { return false; }
+};
+
+// "Are all subsystems OK?": stops at the first false reply.
+struct CReduceAllOf {
+    using Result = bool;
+    Result init() const { return true; }
+    template <typename R>
+    void combine(Result& acc, const R& value) const { acc = acc && static_cast<bool>(value); }
+    void merge(Result& acc, Result other) const { acc = acc && other; }
+    bool done(const Result& acc) const { return !acc; }
+};
+
+// First reply (in subscription order) that tests true, e.g. a pointer or optional.
+template <typename R>
+struct CReduceFirstNonNull {
+    using Result = R;
+    Result init() const { return R{}; }
+    void combine(Result& acc, R value) const { if (!acc && value) acc = std::move(value); }
+    void merge(Result& acc, Result other) const { if (!acc) acc = std::move(other); }
+    bool done(const Result& acc) const { return static_cast<bool>(acc); }
+};
+
+template <typename R>
+struct CReduceVector {
+    using Result = std::vector<R>;
+    Result init() const { return Result(); }
+    void combine(Result& acc, R value) const { acc.push_back(std::move(value)); }
+    void merge(Result& acc, Result other) const {
+        acc.insert(acc.end(), std::make_move_iterator(other.begin()), std::make_move_iterator(other.end()));
+    }
+    bool done(const Result&) const { return false; }
+};
+
+template <typename R, typename... Args>
+class CCollectEvent : public std::enable_shared_from_this<CCollectEvent<R, Args...>> {
+public:
+    using Callback = std::function<R(Args...)>;
+
+    class Subscription {
+        friend class CCollectEvent;
+    public:
+        ~Subscription() {
+            if (auto event = event_.lock()) {
+                event->unsubscribe(id_);
+            }
+        }
+
+        Subscription(Subscription&& other) noexcept
+            : event_(std::move(other.event_)), id_(other.id_) {
+            other.id_ = -1;
+        }
+
+        Subscription& operator=(Subscription&& other) noexcept {
+            if (this != &other) {
+                event_ = std::move(other.event_);
+                id_ = other.id_;
+                other.id_ = -1;
+            }
+            return *this;
+        }
+
+        Subscription(const Subscription&) = delete;
+        Subscription& operator=(const Subscription&) = delete;
+
+    private:
+        Subscription(std::weak_ptr<CCollectEvent> event, int id)
+            : event_(std::move(event)), id_(id) {}
+
+        std::weak_ptr<CCollectEvent> event_;
+        int id_ = -1;
+    };
+
+    Subscription subscribe(Callback callback) {
+        std::weak_ptr<CCollectEvent> weakSelf = this->shared_from_this();
+        std::lock_guard<std::mutex> lock(mutex_);
+        int id = nextId_++;
+        callbacks_.push_back(std::make_shared<CallbackEntry>(id, std::move(callback)));
+        return Subscription(std::move(weakSelf), id);
+    }
+
+    // Calls subscribers in order on this thread and folds their replies.
+    template <typename Reducer>
+    typename Reducer::Result trigger_collect(const Reducer& reducer, Args... args) {
+        return collect(reducer, snapshot(), args...);
+    }
+
+    // Same result as trigger_collect(), with subscribers run in parallel on pool.
+    // The calling thread works on chunks too, so it never waits on an idle pool.
+    template <typename Reducer>
+    typename Reducer::Result trigger_collect_parallel(const Reducer& reducer, CThreadPool& pool, Args... args) {
+        using Result = typename Reducer::Result;
+        using Entries = std::vector<std::shared_ptr<CallbackEntry>>;
+
+        // Everything a late-starting pool task touches lives here.
+        struct State {
+            Entries entries;
+            Reducer reducer;
+            std::tuple<std::decay_t<Args>...> args;
+            std::vector<Partial<Result>> partial;
+            size_t chunks = 0;
+            std::atomic<size_t> next{0};
+            std::atomic<size_t> remaining{0};
+            std::mutex mutex;
+            std::condition_variable cv;
+            std::exception_ptr error;
+
+            State(Entries e, const Reducer& r, Args... a)
+                : entries(std::move(e)), reducer(r), args(a...) {}
+
+            void work() {
+                size_t chunk;
+                while ((chunk = next.fetch_add(1)) < chunks) {
+                    size_t begin = chunk * entries.size() / chunks;
+                    size_t end = (chunk + 1) * entries.size() / chunks;
+                    try {
+                        Result& acc = partial[chunk].value;
+                        for (size_t i = begin; i < end && !reducer.done(acc); ++i) {
+                            reducer.combine(acc, std::apply(entries[i]->callback, args));
+                        }
+                    } catch (...) {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        if (!error) error = std::current_exception();
+                    }
+                    if (remaining.fetch_sub(1) == 1) {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        cv.notify_all();
+                    }
+                }
+            }
+        };
+
+        auto state = std::make_shared<State>(snapshot(), reducer, args...);
+        state->chunks = std::min(state->entries.size(), pool.size() + 1);
+        if (state->chunks <= 1) {
+            return collect(reducer, state->entries, args...);
+        }
+        state->partial.assign(state->chunks, Partial<Result>{reducer.init()});
+        state->remaining = state->chunks;
+
+        for (size_t i = 1; i < state->chunks; ++i) {
+            pool.submit([state]() { state->work(); });
+        }
+        state->work();
+        {
+            std::unique_lock<std::mutex> lock(state->mutex);
+            state->cv.wait(lock, [&state]() { return state->remaining.load() == 0; });
+        }
+        if (state->error) std::rethrow_exception(state->error);
+
+        // Pairwise tree merge; partial[0] ends up holding the result.
+        for (size_t step = 1; step < state->chunks; step *= 2) {
+            for (size_t i = 0; i + step < state->chunks; i += 2 * step) {
+                reducer.merge(state->partial[i].value, std::move(state->partial[i + step].value));
+            }
+        }
+        return std::move(state->partial[0].value);
+    }
+
+private:
+    struct CallbackEntry {
+        int id;
+        Callback callback;
+        bool active;
+
+        CallbackEntry(int id, Callback callback, bool active = true)
+            : id(id), callback(std::move(callback)), active(active) {}
+    };
+
+    // Keeps std::vector<bool> out of the per-chunk results.
+    template <typename Result>
+    struct Partial {
+        Result value;
+    };
+
+    template <typename Reducer>
+    static typename Reducer::Result collect(const Reducer& reducer,
+            const std::vector<std::shared_ptr<CallbackEntry>>& entries, Args... args) {
+        auto result = reducer.init();
+        for (auto& entry : entries) {
+            if (reducer.done(result)) break;
+            reducer.combine(result, entry->callback(args...));
+        }
+        return result;
+    }
+
+    std::vector<std::shared_ptr<CallbackEntry>> snapshot() {
+        std::vector<std::shared_ptr<CallbackEntry>> activeEntries;
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (needsCleanup_) {
+            callbacks_.erase(
+                std::remove_if(callbacks_.begin(), callbacks_.end(),
+                    [](const std::shared_ptr<CallbackEntry>& entry) {
+                        return !entry->active;
+                    }),
+                callbacks_.end());
+            needsCleanup_ = false;
+        }
+        activeEntries.reserve(callbacks_.size());
+        for (auto& entry : callbacks_) {
+            if (entry->active) {
+                activeEntries.push_back(entry);
+            }
+        }
+        return activeEntries;
+    }
+
+    void unsubscribe(int id) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = std::find_if(callbacks_.begin(), callbacks_.end(),
+            [id](const std::shared_ptr<CallbackEntry>& entry) {
+                return entry->id == id;
+            });
+        if (it != callbacks_.end()) {
+            (*it)->active = false;
+            needsCleanup_ = true;
+        }
+    }
+
+    mutable std::mutex mutex_;
+    bool needsCleanup_ = false;
+    int nextId_ = 0;
+    std::vector<std::shared_ptr<CallbackEntry>> callbacks_;
+};
+
+// usage example
+/*
+auto onHealthCheck = std::make_shared<CCollectEvent<bool>>();
+auto dbSub = onHealthCheck->subscribe([]() { return db.ping(); });
+auto ioSub = onHealthCheck->subscribe([]() { return io.ok(); });
+
+bool allOk = onHealthCheck->trigger_collect(CReduceAllOf());
+
+CThreadPool pool(4);
+bool allOkParallel = onHealthCheck->trigger_collect_parallel(CReduceAllOf(), pool);
+*/
+
+#endif
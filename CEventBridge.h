@@ -0,0 +1,389 @@
+/**************************************************************
+
+DESCRIPTION
+
+	This file defines a local event bridge that forwards selected
+	CEventSafe events to another process over a Unix domain socket.
+
+	CEventBridgeSender subscribes to events and appends each
+	trigger as a frame [u32 length][u32 channel][CEventCodec frame]
+	into reusable chunks. Chunks go out together in one sendmsg()
+	(writev-style) when the batch fills, on flush(), or every
+	flush_interval_ms from a background thread. The send runs
+	outside the lock that triggers append under, on one thread at a
+	time; frames arriving meanwhile go into the next batch. With a
+	background thread, a full batch only wakes it, so publishers
+	never block on the socket; while a slow peer stalls the send,
+	pending bytes are capped and further frames are dropped and
+	counted. Without one, the trigger that fills the batch sends it.
+	CEventBridgeReceiver reads the stream, decodes each frame by
+	channel and re-triggers the routed local event.
+
+	Both ends take a connected stream socket, so a socketpair()
+	is enough to run the bridge inside one process.
+
+**************************************************************/
+
+
+#ifndef __CEventBridge_h__
+#define __CEventBridge_h__
+
+#include "EventTemplate.h"
+#include "CEventCodec.h"
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Socket helpers; all return -1 on failure with errno set.
+inline int bridge_listen(const std::string& path, int backlog = 8) {
+    sockaddr_un addr{};
+    if (path.size() >= sizeof(addr.sun_path)) { errno = ENAMETOOLONG; return -1; }
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    ::unlink(path.c_str());
+    if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || listen(fd, backlog) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+inline int bridge_accept(int listen_fd) {
+    int fd;
+    while ((fd = accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC)) < 0 && errno == EINTR);
+    return fd;
+}
+
+inline int bridge_connect(const std::string& path) {
+    sockaddr_un addr{};
+    if (path.size() >= sizeof(addr.sun_path)) { errno = ENAMETOOLONG; return -1; }
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+class CEventBridgeSender {
+public:
+    // Takes ownership of a connected stream socket. max_pending_bytes caps
+    // what may wait behind a send in progress (at least batch_bytes).
+    explicit CEventBridgeSender(int fd, size_t batch_bytes = 64 * 1024, unsigned int flush_interval_ms = 0,
+                                size_t max_pending_bytes = 1024 * 1024)
+        : fd_(fd), batch_bytes_(batch_bytes), max_pending_(std::max(max_pending_bytes, batch_bytes)) {
+        if (flush_interval_ms > 0) {
+            background_ = true;
+            flusher_ = std::thread([this, flush_interval_ms]() {
+                std::unique_lock<std::mutex> lock(mutex_);
+                while (!stopping_) {
+                    stop_cv_.wait_for(lock, std::chrono::milliseconds(flush_interval_ms),
+                                      [this]() { return stopping_ || batchFull_; });
+                    batchFull_ = false;
+                    if (!sending_ && buffered_ > 0) {
+                        sending_ = true;
+                        send_batches(lock);
+                    }
+                }
+            });
+        }
+    }
+
+    ~CEventBridgeSender() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        stop_cv_.notify_all();
+        if (flusher_.joinable()) flusher_.join();
+        flush();
+        if (fd_ >= 0) close(fd_);
+    }
+
+    CEventBridgeSender(const CEventBridgeSender&) = delete;
+    CEventBridgeSender& operator=(const CEventBridgeSender&) = delete;
+
+    // Forward every trigger of event to the peer's route for channel.
+    // Keep the returned subscription alive for as long as forwarding should
+    // last, and release it before the sender is destroyed.
+    template <typename... Args>
+    typename CEventSafe<Args...>::Subscription forward(const std::shared_ptr<CEventSafe<Args...>>& event,
+                                                       uint32_t channel) {
+        return event->subscribe([this, channel](Args... args) {
+            send_event<Args...>(channel, args...);
+        });
+    }
+
+    // Queue one event directly, without going through a subscription.
+    // False if the peer is gone, or the frame was dropped because it does
+    // not fit a u32 length or the pending bytes are at their cap.
+    template <typename... Args>
+    bool send_event(uint32_t channel, const std::decay_t<Args>&... args) {
+        using Codec = CEventCodec<Args...>;
+        size_t payload = Codec::encoded_size(args...);
+        size_t frame = kFrameHeader + payload;
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (failed_) return false;
+        if (frame > UINT32_MAX || buffered_ + frame > max_pending_) {
+            framesDropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        char* p = reserve_locked(frame);
+        uint32_t len = static_cast<uint32_t>(frame);
+        std::memcpy(p, &len, sizeof(len));
+        std::memcpy(p + sizeof(len), &channel, sizeof(channel));
+        Codec::encode(p + kFrameHeader, payload, args...);
+        ++frames_;
+        if (buffered_ < batch_bytes_) return true;
+        if (background_) {
+            batchFull_ = true;
+            stop_cv_.notify_one();
+            return true;
+        }
+        // If another thread is sending, it picks this batch up when it is done.
+        if (sending_) return true;
+        sending_ = true;
+        return send_batches(lock);
+    }
+
+    // Sends everything queued so far, waiting for a send already in progress.
+    bool flush() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        sent_cv_.wait(lock, [this]() { return !sending_; });
+        if (buffered_ == 0 || failed_) return !failed_;
+        sending_ = true;
+        return send_batches(lock);
+    }
+
+    unsigned long frames_sent() const { return framesSent_.load(std::memory_order_relaxed); }
+    unsigned long frames_dropped() const { return framesDropped_.load(std::memory_order_relaxed); }
+    unsigned long send_calls() const { return sendCalls_.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr size_t kFrameHeader = 2 * sizeof(uint32_t);
+    static constexpr size_t kChunkSize = 16 * 1024;
+
+    struct Chunk {
+        std::vector<char> data;
+        size_t used = 0;
+    };
+
+    // Space for one frame at the end of the current chunk; chunks are kept
+    // across flushes so steady-state sending does not allocate.
+    char* reserve_locked(size_t bytes) {
+        if (active_ == chunks_.size() || chunks_[active_].data.size() - chunks_[active_].used < bytes) {
+            if (active_ < chunks_.size() && chunks_[active_].used > 0) ++active_;
+            if (active_ == chunks_.size()) chunks_.emplace_back();
+            Chunk& fresh = chunks_[active_];
+            if (fresh.data.size() < bytes) fresh.data.resize(std::max(bytes, kChunkSize));
+        }
+        Chunk& chunk = chunks_[active_];
+        char* p = chunk.data.data() + chunk.used;
+        chunk.used += bytes;
+        buffered_ += bytes;
+        return p;
+    }
+
+    // Called with sending_ set by the caller. Hands the filled chunks over
+    // to the send set and sends them with the lock released, until nothing
+    // is left; then clears sending_.
+    bool send_batches(std::unique_lock<std::mutex>& lock) {
+        while (buffered_ > 0 && !failed_) {
+            std::swap(chunks_, sending_chunks_);
+            unsigned long frames = frames_;
+            active_ = 0;
+            buffered_ = 0;
+            frames_ = 0;
+            lock.unlock();
+            bool ok = send_chunks();
+            lock.lock();
+            if (ok) framesSent_.fetch_add(frames, std::memory_order_relaxed);
+            else failed_ = true;    // peer gone; drop this and later batches
+        }
+        sending_ = false;
+        sent_cv_.notify_all();
+        return !failed_;
+    }
+
+    // Sending thread only.
+    bool send_chunks() {
+        iovecs_.clear();
+        for (auto& chunk : sending_chunks_) {
+            if (chunk.used) iovecs_.push_back(iovec{chunk.data.data(), chunk.used});
+        }
+
+        bool ok = true;
+        size_t first = 0;
+        while (first < iovecs_.size()) {
+            msghdr msg{};
+            msg.msg_iov = &iovecs_[first];
+            msg.msg_iovlen = iovecs_.size() - first;
+            ssize_t sent = sendmsg(fd_, &msg, MSG_NOSIGNAL);
+            sendCalls_.fetch_add(1, std::memory_order_relaxed);
+            if (sent < 0) {
+                if (errno == EINTR) continue;
+                ok = false;
+                break;
+            }
+            // Skip fully written iovecs, trim a partially written one.
+            size_t left = static_cast<size_t>(sent);
+            while (first < iovecs_.size() && left >= iovecs_[first].iov_len) {
+                left -= iovecs_[first].iov_len;
+                ++first;
+            }
+            if (left > 0) {
+                iovecs_[first].iov_base = static_cast<char*>(iovecs_[first].iov_base) + left;
+                iovecs_[first].iov_len -= left;
+            }
+        }
+
+        for (auto& chunk : sending_chunks_) chunk.used = 0;
+        return ok;
+    }
+
+    int fd_;
+    size_t batch_bytes_;
+    size_t max_pending_;
+    std::mutex mutex_;
+    std::condition_variable stop_cv_;
+    std::condition_variable sent_cv_;
+    bool stopping_ = false;
+    bool failed_ = false;
+    bool sending_ = false;              // one thread owns sending_chunks_ and the socket
+    bool background_ = false;           // the flusher thread does all automatic sends
+    bool batchFull_ = false;            // wakes the flusher early
+    std::vector<Chunk> chunks_;         // being filled, under mutex_
+    std::vector<Chunk> sending_chunks_;
+    std::vector<iovec> iovecs_;
+    size_t active_ = 0;
+    size_t buffered_ = 0;
+    unsigned long frames_ = 0;
+    std::atomic<unsigned long> framesSent_{0};
+    std::atomic<unsigned long> framesDropped_{0};
+    std::atomic<unsigned long> sendCalls_{0};
+    std::thread flusher_;
+};
+
+class CEventBridgeReceiver {
+public:
+    // Takes ownership of a connected stream socket.
+    explicit CEventBridgeReceiver(int fd) : fd_(fd), buffer_(64 * 1024) {}
+
+    ~CEventBridgeReceiver() {
+        if (fd_ >= 0) close(fd_);
+    }
+
+    CEventBridgeReceiver(const CEventBridgeReceiver&) = delete;
+    CEventBridgeReceiver& operator=(const CEventBridgeReceiver&) = delete;
+
+    // Re-trigger event for frames arriving on channel. Args must match the sender's.
+    template <typename... Args>
+    void route(uint32_t channel, std::shared_ptr<CEventSafe<Args...>> event) {
+        routes_[channel] = [event](const char* data, size_t len) {
+            typename CEventCodec<Args...>::Tuple args;
+            if (!CEventCodec<Args...>::decode(data, len, args)) return false;
+            std::apply([&event](auto&... values) { event->trigger(values...); }, args);
+            return true;
+        };
+    }
+
+    // Wait up to timeout_ms (-1 = forever) for data and dispatch every complete
+    // frame. Returns frames dispatched, or -1 once the peer has closed.
+    int poll(int timeout_ms) {
+        pollfd pfd{fd_, POLLIN, 0};
+        int ready;
+        while ((ready = ::poll(&pfd, 1, timeout_ms)) < 0 && errno == EINTR);
+        if (ready <= 0) return ready < 0 ? -1 : 0;
+
+        if (buffer_.size() - used_ < kMinRead) buffer_.resize(buffer_.size() * 2);
+        ssize_t got;
+        while ((got = recv(fd_, buffer_.data() + used_, buffer_.size() - used_, 0)) < 0 && errno == EINTR);
+        if (got <= 0) return -1;
+        used_ += static_cast<size_t>(got);
+        return dispatch();
+    }
+
+    unsigned long frames_dropped() const { return dropped_; }
+
+private:
+    static constexpr size_t kFrameHeader = 2 * sizeof(uint32_t);
+    static constexpr size_t kMinRead = 4096;
+
+    int dispatch() {
+        int count = 0;
+        size_t pos = 0;
+        while (used_ - pos >= kFrameHeader) {
+            uint32_t len, channel;
+            std::memcpy(&len, buffer_.data() + pos, sizeof(len));
+            std::memcpy(&channel, buffer_.data() + pos + sizeof(len), sizeof(channel));
+            if (len < kFrameHeader) return -1;  // corrupt stream
+            if (used_ - pos < len) {
+                if (len > buffer_.size()) buffer_.resize(len);
+                break;
+            }
+            auto it = routes_.find(channel);
+            if (it != routes_.end() && it->second(buffer_.data() + pos + kFrameHeader, len - kFrameHeader)) {
+                ++count;
+            } else {
+                ++dropped_;  // unrouted channel or schema mismatch
+            }
+            pos += len;
+        }
+        // Keep the partial frame at the front of the buffer.
+        if (pos > 0) {
+            std::memmove(buffer_.data(), buffer_.data() + pos, used_ - pos);
+            used_ -= pos;
+        }
+        return count;
+    }
+
+    int fd_;
+    std::vector<char> buffer_;
+    size_t used_ = 0;
+    unsigned long dropped_ = 0;
+    std::unordered_map<uint32_t, std::function<bool(const char*, size_t)>> routes_;
+};
+
+// usage example
+/*
+// process A: publisher
+auto onStatus = std::make_shared<CEventSafe<int, std::string>>();
+CEventBridgeSender sender(bridge_connect("/tmp/dev_status.sock"), 64 * 1024, 5);
+auto link = sender.forward(onStatus, 1);
+onStatus->trigger(7, "Dev_7 Ok");   // batched, sent within 5 ms
+
+// process B: GUI
+auto onRemoteStatus = std::make_shared<CEventSafe<int, std::string>>();
+auto sub = onRemoteStatus->subscribe([](int id, std::string text) { std::cout << id << " " << text << std::endl; });
+int listener = bridge_listen("/tmp/dev_status.sock");
+CEventBridgeReceiver receiver(bridge_accept(listener));
+receiver.route(1, onRemoteStatus);
+while (receiver.poll(-1) >= 0) {}
+
+// single process: int fds[2]; socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+// CEventBridgeSender sender(fds[0]); CEventBridgeReceiver receiver(fds[1]);
+*/
+
+#endif
@@ -0,0 +1,308 @@
+/**************************************************************
+
+DESCRIPTION
+
+	This file defines CEventCodec, a binary codec for event
+	argument tuples, used to carry Args... across processes or
+	into journals.
+
+	Trivially copyable fields are memcpy'd, std::string and
+	std::vector<POD> are length-prefixed (u32). Every frame starts
+	with a schema hash computed at compile time from the argument
+	types, so a reader built with different Args rejects the frame.
+	Structs only differ in that hash by their declared type id
+	(kCodecTypeId or CCodecTypeId), which they must provide.
+	decode_views() does not copy: strings come back as
+	std::string_view and vectors as CPodView into the caller's
+	buffer. Encoding never allocates. Byte order is native.
+
+**************************************************************/
+
+
+#ifndef __CEventCodec_h__
+#define __CEventCodec_h__
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+// Read-only view of a length-prefixed POD array inside a decoded buffer.
+// Elements are copied out on access, so the buffer needs no alignment.
+template <typename T>
+class CPodView {
+public:
+    CPodView() = default;
+    CPodView(const char* data, size_t count) : data_(data), count_(count) {}
+
+    size_t size() const { return count_; }
+    bool empty() const { return count_ == 0; }
+    const char* bytes() const { return data_; }
+
+    T operator[](size_t i) const {
+        T value;
+        std::memcpy(&value, data_ + i * sizeof(T), sizeof(T));
+        return value;
+    }
+
+    std::vector<T> to_vector() const {
+        std::vector<T> out(count_);
+        if (count_) std::memcpy(out.data(), data_, count_ * sizeof(T));
+        return out;
+    }
+
+private:
+    const char* data_ = nullptr;
+    size_t count_ = 0;
+};
+
+namespace codec_detail {
+
+constexpr uint64_t kFnvOffset = 14695981039346656037ULL;
+constexpr uint64_t kFnvPrime = 1099511628211ULL;
+
+constexpr uint64_t mix(uint64_t hash, uint64_t value) {
+    for (int i = 0; i < 8; ++i) {
+        hash ^= (value >> (i * 8)) & 0xff;
+        hash *= kFnvPrime;
+    }
+    return hash;
+}
+
+constexpr uint64_t mix_name(uint64_t hash, const char* name) {
+    while (*name) {
+        hash ^= static_cast<unsigned char>(*name++);
+        hash *= kFnvPrime;
+    }
+    return hash;
+}
+
+inline void put_u32(char*& p, uint32_t v) { std::memcpy(p, &v, sizeof(v)); p += sizeof(v); }
+
+inline bool get_u32(const char*& p, const char* end, uint32_t& v) {
+    if (static_cast<size_t>(end - p) < sizeof(v)) return false;
+    std::memcpy(&v, p, sizeof(v));
+    p += sizeof(v);
+    return true;
+}
+
+} // namespace codec_detail
+
+// Type id for codec_type_id members: a hash of a name such as "DevStatus/2".
+constexpr uint64_t codec_type_id(const char* name) {
+    return codec_detail::mix_name(codec_detail::kFnvOffset, name);
+}
+
+// Identity of a trivially copyable struct in the schema hash. Declare
+//     static constexpr uint64_t kCodecTypeId = codec_type_id("DevStatus/2");
+// in the struct (change it with the layout), or specialise CCodecTypeId
+// for types you cannot edit.
+template <typename T, typename Enable = void>
+struct CCodecTypeId {
+    static constexpr bool defined = false;
+    static constexpr uint64_t value = 0;
+};
+
+template <typename T>
+struct CCodecTypeId<T, std::void_t<decltype(T::kCodecTypeId)>> {
+    static constexpr bool defined = true;
+    static constexpr uint64_t value = T::kCodecTypeId;
+};
+
+// Per-type wire format. Specialise for further types.
+template <typename T, typename Enable = void>
+struct CCodecTraits;
+
+template <typename T, size_t N>
+struct CCodecTypeId<std::array<T, N>> {
+    static constexpr bool defined = true;
+    static constexpr uint64_t value = codec_detail::mix(
+        codec_detail::mix(codec_detail::mix(codec_detail::kFnvOffset, 0x41525259ULL), CCodecTraits<T>::tag()), N);
+};
+
+template <typename T>
+struct CCodecTraits<T, std::enable_if_t<std::is_trivially_copyable<T>::value>> {
+    static_assert(!std::is_pointer<T>::value, "pointers cannot be serialized");
+    using View = T;
+
+    static_assert(!std::is_class<T>::value || CCodecTypeId<T>::defined,
+                  "structs need a kCodecTypeId (or a CCodecTypeId specialisation) to be told apart");
+
+    static constexpr uint64_t tag() {
+        uint64_t kind = std::is_floating_point<T>::value ? 1
+                      : std::is_integral<T>::value ? 2
+                      : std::is_enum<T>::value ? 3 : 4;
+        uint64_t h = codec_detail::mix(codec_detail::kFnvOffset, kind);
+        h = codec_detail::mix(h, std::is_signed<T>::value);
+        h = codec_detail::mix(h, sizeof(T));
+        h = codec_detail::mix(h, alignof(T));
+        return CCodecTypeId<T>::defined ? codec_detail::mix(h, CCodecTypeId<T>::value) : h;
+    }
+    static size_t size(const T&) { return sizeof(T); }
+    static void write(char*& p, const T& value) { std::memcpy(p, &value, sizeof(T)); p += sizeof(T); }
+    static bool read(const char*& p, const char* end, View& out) {
+        if (static_cast<size_t>(end - p) < sizeof(T)) return false;
+        std::memcpy(&out, p, sizeof(T));
+        p += sizeof(T);
+        return true;
+    }
+    static T own(const View& view) { return view; }
+};
+
+template <>
+struct CCodecTraits<std::string> {
+    using View = std::string_view;
+
+    static constexpr uint64_t tag() { return codec_detail::mix(codec_detail::kFnvOffset, 0x5354524eULL); }
+    static size_t size(const std::string& s) { return sizeof(uint32_t) + s.size(); }
+    static void write(char*& p, const std::string& s) {
+        codec_detail::put_u32(p, static_cast<uint32_t>(s.size()));
+        std::memcpy(p, s.data(), s.size());
+        p += s.size();
+    }
+    static bool read(const char*& p, const char* end, View& out) {
+        uint32_t len;
+        if (!codec_detail::get_u32(p, end, len) || static_cast<size_t>(end - p) < len) return false;
+        out = View(p, len);
+        p += len;
+        return true;
+    }
+    static std::string own(const View& view) { return std::string(view); }
+};
+
+template <typename T>
+struct CCodecTraits<std::vector<T>, std::enable_if_t<std::is_trivially_copyable<T>::value>> {
+    using View = CPodView<T>;
+
+    static constexpr uint64_t tag() {
+        return codec_detail::mix(codec_detail::mix(codec_detail::kFnvOffset, 0x56454354ULL),
+                                 CCodecTraits<T>::tag());
+    }
+    static size_t size(const std::vector<T>& v) { return sizeof(uint32_t) + v.size() * sizeof(T); }
+    static void write(char*& p, const std::vector<T>& v) {
+        codec_detail::put_u32(p, static_cast<uint32_t>(v.size()));
+        if (!v.empty()) std::memcpy(p, v.data(), v.size() * sizeof(T));
+        p += v.size() * sizeof(T);
+    }
+    static bool read(const char*& p, const char* end, View& out) {
+        uint32_t count;
+        if (!codec_detail::get_u32(p, end, count)) return false;
+        if (static_cast<size_t>(end - p) / sizeof(T) < count) return false;
+        out = View(p, count);
+        p += static_cast<size_t>(count) * sizeof(T);
+        return true;
+    }
+    static std::vector<T> own(const View& view) { return view.to_vector(); }
+};
+
+template <typename... Args>
+class CEventCodec {
+public:
+    using Tuple = std::tuple<std::decay_t<Args>...>;
+    using Views = std::tuple<typename CCodecTraits<std::decay_t<Args>>::View...>;
+
+    // Frame header: u64 schema hash + u32 payload size
+    static constexpr size_t kHeaderSize = sizeof(uint64_t) + sizeof(uint32_t);
+
+    static constexpr uint64_t schema_hash() {
+        uint64_t h = codec_detail::mix(codec_detail::kFnvOffset, sizeof...(Args));
+        const uint64_t tags[] = { 0, CCodecTraits<std::decay_t<Args>>::tag()... };
+        for (size_t i = 1; i <= sizeof...(Args); ++i) h = codec_detail::mix(h, tags[i]);
+        return h;
+    }
+
+    static size_t encoded_size(const std::decay_t<Args>&... args) {
+        return kHeaderSize + (size_t(0) + ... + CCodecTraits<std::decay_t<Args>>::size(args));
+    }
+
+    // Returns bytes written, or 0 if cap is too small or the payload does not
+    // fit the u32 frame size. Every length prefix is bounded by the payload,
+    // so that check also keeps string and vector lengths within u32.
+    static size_t encode(char* buf, size_t cap, const std::decay_t<Args>&... args) {
+        size_t total = encoded_size(args...);
+        if (total > cap || total - kHeaderSize > UINT32_MAX) return 0;
+        char* p = buf;
+        uint64_t hash = schema_hash();
+        std::memcpy(p, &hash, sizeof(hash));
+        p += sizeof(hash);
+        codec_detail::put_u32(p, static_cast<uint32_t>(total - kHeaderSize));
+        (CCodecTraits<std::decay_t<Args>>::write(p, args), ...);
+        return total;
+    }
+
+    static size_t encode_tuple(char* buf, size_t cap, const Tuple& tuple) {
+        return std::apply([&](const auto&... args) { return encode(buf, cap, args...); }, tuple);
+    }
+
+    // Size of the frame at buf, or 0 if the header is incomplete or foreign.
+    static size_t frame_size(const char* buf, size_t len) {
+        if (len < kHeaderSize) return 0;
+        uint64_t hash;
+        std::memcpy(&hash, buf, sizeof(hash));
+        if (hash != schema_hash()) return 0;
+        uint32_t payload;
+        std::memcpy(&payload, buf + sizeof(hash), sizeof(payload));
+        return kHeaderSize + payload;
+    }
+
+    // Zero-copy decode: views alias buf and are valid while buf is.
+    static bool decode_views(const char* buf, size_t len, Views& out) {
+        size_t frame = frame_size(buf, len);
+        if (frame == 0 || frame > len) return false;
+        const char* p = buf + kHeaderSize;
+        const char* end = buf + frame;
+        bool ok = read_all(p, end, out, std::index_sequence_for<Args...>());
+        return ok && p == end;
+    }
+
+    // Owning decode into the argument types.
+    static bool decode(const char* buf, size_t len, Tuple& out) {
+        Views views;
+        if (!decode_views(buf, len, views)) return false;
+        own_all(views, out, std::index_sequence_for<Args...>());
+        return true;
+    }
+
+private:
+    template <size_t... I>
+    static bool read_all(const char*& p, const char* end, Views& out, std::index_sequence<I...>) {
+        return (CCodecTraits<std::tuple_element_t<I, Tuple>>::read(p, end, std::get<I>(out)) && ...);
+    }
+
+    template <size_t... I>
+    static void own_all(const Views& views, Tuple& out, std::index_sequence<I...>) {
+        ((std::get<I>(out) = CCodecTraits<std::tuple_element_t<I, Tuple>>::own(std::get<I>(views))), ...);
+    }
+};
+
+// usage example
+/*
+using StatusCodec = CEventCodec<int, std::string, std::vector<float>>;
+
+char buf[256];
+size_t n = StatusCodec::encode(buf, sizeof(buf), 7, std::string("Dev_7 Ok"), std::vector<float>{1.f, 2.f});
+
+StatusCodec::Views views;                 // int, std::string_view, CPodView<float>
+if (StatusCodec::decode_views(buf, n, views)) {
+    std::cout << std::get<1>(views) << std::endl;
+}
+
+// throughput benchmark
+auto t0 = std::chrono::steady_clock::now();
+const int kIters = 10000000;
+std::string text("Dev_7 Ok");
+std::vector<float> samples(8, 1.f);
+for (int i = 0; i < kIters; ++i) {
+    n = StatusCodec::encode(buf, sizeof(buf), i, text, samples);
+    StatusCodec::decode_views(buf, n, views);
+}
+double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+std::cout << kIters / secs / 1e6 << " M encode+decode/s, "
+          << kIters * n / secs / 1e9 << " GB/s" << std::endl;
+*/
+
+#endif
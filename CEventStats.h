@@ -0,0 +1,368 @@
+/**************************************************************
+
+DESCRIPTION
+
+	This file defines live event statistics kept in shared memory,
+	so a separate process (tools/eventtop.cpp) can watch them.
+
+	CEventStatsRegion maps a POSIX shared-memory object holding
+	a header and a fixed number of CEventStatsSlot. An event or
+	dispatcher that opts in gets a slot. It then counts triggers,
+	handler calls and drops, and records handler latency into a
+	log2 histogram. It also keeps two gauges, the subscriber count
+	and the queue depth. EventTemplate.h does not include this
+	header; only code that attaches a slot needs it (and -lrt on
+	older glibc).
+
+	Counters are split into per-thread shards updated with relaxed
+	atomics, so the hot path takes no lock and threads do not
+	share cache lines. Readers sum the shards; rates come from
+	diffing two reads.
+
+	Subscriber slots time one subscription (timed_subscriber());
+	timer slots hold CTimedEvent lateness, not handler time, in
+	the histogram.
+
+**************************************************************/
+
+
+#ifndef __CEventStats_h__
+#define __CEventStats_h__
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+enum class EStatsKind : uint32_t {
+    Event = 1,
+    Dispatcher = 2,
+    Subscriber = 3,
+    Timer = 4
+};
+
+struct CEventStatsSnapshot {
+    static constexpr size_t kLatencyBuckets = 32;  // bucket b: [2^b, 2^(b+1)) ns
+
+    char name[48];
+    EStatsKind kind;
+    uint64_t triggers;
+    uint64_t calls;
+    uint64_t drops;
+    int64_t subscribers;
+    int64_t queue_depth;
+    uint64_t latency[kLatencyBuckets];
+    uint64_t latency_sum_ns;
+
+    // Upper bound of the bucket holding quantile q (0..1) of handler latency.
+    uint64_t latency_quantile_ns(double q) const {
+        uint64_t total = 0;
+        for (uint64_t count : latency) total += count;
+        if (total == 0) return 0;
+        uint64_t rank = static_cast<uint64_t>(q * static_cast<double>(total - 1)) + 1;
+        uint64_t seen = 0;
+        for (size_t b = 0; b < kLatencyBuckets; ++b) {
+            seen += latency[b];
+            if (seen >= rank) return (uint64_t(2) << b) - 1;
+        }
+        return ~uint64_t(0);
+    }
+};
+
+struct CEventStatsSlot {
+    static constexpr size_t kShards = 16;
+    static constexpr size_t kLatencyBuckets = CEventStatsSnapshot::kLatencyBuckets;
+
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "stats atomics must be address-free");
+
+    // Writer side: callable from any thread, never blocks.
+    void count_trigger() { shard().triggers.fetch_add(1, std::memory_order_relaxed); }
+    void count_drop(uint64_t n = 1) { shard().drops.fetch_add(n, std::memory_order_relaxed); }
+    void add_subscribers(int64_t delta) { subscribers.fetch_add(delta, std::memory_order_relaxed); }
+    void set_subscribers(int64_t n) { subscribers.store(n, std::memory_order_relaxed); }
+    void set_queue_depth(int64_t n) { queue_depth.store(n, std::memory_order_relaxed); }
+
+    // One handler call taking ns nanoseconds.
+    void record_latency(uint64_t ns) {
+        Shard& s = shard();
+        s.calls.fetch_add(1, std::memory_order_relaxed);
+        size_t bucket = 0;
+        while (bucket + 1 < kLatencyBuckets && (uint64_t(2) << bucket) <= ns) ++bucket;
+        s.latency[bucket].fetch_add(1, std::memory_order_relaxed);
+        s.latency_sum_ns.fetch_add(ns, std::memory_order_relaxed);
+    }
+
+    static uint64_t now_ns() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    bool live() const { return state.load(std::memory_order_acquire) == kLive; }
+
+    // Reader side: sums the shards. Counters may be mid-update, never torn.
+    CEventStatsSnapshot read() const {
+        CEventStatsSnapshot snap{};
+        std::memcpy(snap.name, name, sizeof(snap.name));
+        snap.name[sizeof(snap.name) - 1] = '\0';
+        snap.kind = kind;
+        snap.subscribers = subscribers.load(std::memory_order_relaxed);
+        snap.queue_depth = queue_depth.load(std::memory_order_relaxed);
+        for (const Shard& s : shards) {
+            snap.triggers += s.triggers.load(std::memory_order_relaxed);
+            snap.calls += s.calls.load(std::memory_order_relaxed);
+            snap.drops += s.drops.load(std::memory_order_relaxed);
+            for (size_t b = 0; b < kLatencyBuckets; ++b) {
+                snap.latency[b] += s.latency[b].load(std::memory_order_relaxed);
+            }
+            snap.latency_sum_ns += s.latency_sum_ns.load(std::memory_order_relaxed);
+        }
+        return snap;
+    }
+
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> triggers;
+        std::atomic<uint64_t> calls;
+        std::atomic<uint64_t> drops;
+        std::atomic<uint64_t> latency[kLatencyBuckets];
+        std::atomic<uint64_t> latency_sum_ns;
+    };
+
+    static constexpr uint32_t kFree = 0;
+    static constexpr uint32_t kClaimed = 1;    // being initialised
+    static constexpr uint32_t kLive = 2;
+
+    std::atomic<uint32_t> state;
+    EStatsKind kind;
+    char name[48];
+    std::atomic<int64_t> subscribers;
+    std::atomic<int64_t> queue_depth;
+    Shard shards[kShards];
+
+private:
+    // Threads are spread over the shards round-robin, once per thread.
+    Shard& shard() {
+        static std::atomic<unsigned int> nextShard{0};
+        thread_local unsigned int index = nextShard.fetch_add(1, std::memory_order_relaxed) % kShards;
+        return shards[index];
+    }
+};
+
+#if defined(__unix__) || defined(__APPLE__)
+
+class CEventStatsRegion {
+public:
+    static constexpr uint64_t kMagic = 0x3253544154535645ULL;  // "EVSTATS2"
+
+    struct Header {
+        std::atomic<uint64_t> magic;    // written last by create()
+        uint32_t slot_count;
+        uint32_t slot_size;
+        uint64_t created_ns;
+    };
+
+    // Creates the region `name` (e.g. "/myapp_events") for writing. A stale
+    // region of that name is unlinked rather than truncated, so processes still
+    // mapping it keep their pages. Returns nullptr if shared memory is unavailable.
+    static std::shared_ptr<CEventStatsRegion> create(const std::string& name, uint32_t slots = 256) {
+        ::shm_unlink(name.c_str());
+        int fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+        if (fd < 0) return nullptr;
+        size_t bytes = region_bytes(slots);
+        struct stat st;
+        if (::ftruncate(fd, static_cast<off_t>(bytes)) != 0 || ::fstat(fd, &st) != 0) {
+            ::close(fd);
+            ::shm_unlink(name.c_str());
+            return nullptr;
+        }
+        void* base = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (base == MAP_FAILED) {
+            ::shm_unlink(name.c_str());
+            return nullptr;
+        }
+
+        // Fresh pages are zero, which is the initial state of every atomic.
+        auto region = std::shared_ptr<CEventStatsRegion>(new CEventStatsRegion(name, base, bytes, true));
+        region->inode_ = st.st_ino;
+        Header* header = region->header();
+        header->slot_count = slots;
+        header->slot_size = sizeof(CEventStatsSlot);
+        header->created_ns = CEventStatsSlot::now_ns();
+        header->magic.store(kMagic, std::memory_order_release);
+        return region;
+    }
+
+    // Maps an existing region read-only, for inspection tools.
+    static std::shared_ptr<CEventStatsRegion> open(const std::string& name) {
+        int fd = ::shm_open(name.c_str(), O_RDONLY, 0);
+        if (fd < 0) return nullptr;
+        struct stat st;
+        if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(Header)) {
+            ::close(fd);
+            return nullptr;
+        }
+        size_t bytes = static_cast<size_t>(st.st_size);
+        void* base = ::mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (base == MAP_FAILED) return nullptr;
+        auto region = std::shared_ptr<CEventStatsRegion>(new CEventStatsRegion(name, base, bytes, false));
+        const Header* header = region->header();
+        if (header->magic.load(std::memory_order_acquire) != kMagic ||
+            header->slot_size != sizeof(CEventStatsSlot) ||
+            region_bytes(header->slot_count) > bytes) {
+            return nullptr;
+        }
+        return region;
+    }
+
+    // The creator unlinks the region unless a newer create() took over the
+    // name; readers only unmap it.
+    ~CEventStatsRegion() {
+        ::munmap(base_, bytes_);
+        if (owner_ && still_named()) ::shm_unlink(name_.c_str());
+    }
+
+    CEventStatsRegion(const CEventStatsRegion&) = delete;
+    CEventStatsRegion& operator=(const CEventStatsRegion&) = delete;
+
+    // Claims a free slot; returns nullptr when the region is full or read-only.
+    CEventStatsSlot* allocate(const std::string& name, EStatsKind kind = EStatsKind::Event) {
+        if (!owner_) return nullptr;
+        for (uint32_t i = 0; i < slot_count(); ++i) {
+            CEventStatsSlot* slot = slot_at(i);
+            uint32_t expected = CEventStatsSlot::kFree;
+            if (!slot->state.compare_exchange_strong(expected, CEventStatsSlot::kClaimed,
+                                                     std::memory_order_acquire)) {
+                continue;
+            }
+            reset(*slot);
+            slot->kind = kind;
+            std::strncpy(slot->name, name.c_str(), sizeof(slot->name) - 1);
+            slot->name[sizeof(slot->name) - 1] = '\0';
+            slot->state.store(CEventStatsSlot::kLive, std::memory_order_release);
+            return slot;
+        }
+        return nullptr;
+    }
+
+    // Returns a slot to the pool; detach it from its event first.
+    void release(CEventStatsSlot* slot) {
+        if (slot) slot->state.store(CEventStatsSlot::kFree, std::memory_order_release);
+    }
+
+    uint32_t slot_count() const { return header()->slot_count; }
+    const CEventStatsSlot& slot(uint32_t index) const { return *slot_at(index); }
+    uint64_t created_ns() const { return header()->created_ns; }
+
+private:
+    CEventStatsRegion(std::string name, void* base, size_t bytes, bool owner)
+        : name_(std::move(name)), base_(base), bytes_(bytes), owner_(owner) {}
+
+    static size_t slots_offset() {
+        return (sizeof(Header) + alignof(CEventStatsSlot) - 1) & ~(alignof(CEventStatsSlot) - 1);
+    }
+
+    static size_t region_bytes(uint32_t slots) {
+        return slots_offset() + size_t(slots) * sizeof(CEventStatsSlot);
+    }
+
+    static void reset(CEventStatsSlot& slot) {
+        slot.subscribers.store(0, std::memory_order_relaxed);
+        slot.queue_depth.store(0, std::memory_order_relaxed);
+        for (auto& s : slot.shards) {
+            s.triggers.store(0, std::memory_order_relaxed);
+            s.calls.store(0, std::memory_order_relaxed);
+            s.drops.store(0, std::memory_order_relaxed);
+            for (auto& bucket : s.latency) bucket.store(0, std::memory_order_relaxed);
+            s.latency_sum_ns.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    bool still_named() const {
+        int fd = ::shm_open(name_.c_str(), O_RDONLY, 0);
+        if (fd < 0) return false;
+        struct stat st;
+        bool same = ::fstat(fd, &st) == 0 && st.st_ino == inode_;
+        ::close(fd);
+        return same;
+    }
+
+    Header* header() const { return static_cast<Header*>(base_); }
+
+    CEventStatsSlot* slot_at(uint32_t index) const {
+        return reinterpret_cast<CEventStatsSlot*>(static_cast<char*>(base_) + slots_offset()) + index;
+    }
+
+    std::string name_;
+    void* base_;
+    size_t bytes_;
+    bool owner_;
+    ino_t inode_ = 0;   // owner: the object create() made under name_
+};
+
+#endif
+
+template <typename... Args>
+struct CStatsCallback {
+    using Callback = std::function<void(Args...)>;
+};
+
+// Counts one subscriber in a slot for as long as it exists.
+class CStatsSubscriberGauge {
+public:
+    explicit CStatsSubscriberGauge(CEventStatsSlot* slot) : slot_(slot) { slot_->add_subscribers(1); }
+    ~CStatsSubscriberGauge() { slot_->add_subscribers(-1); }
+
+    CStatsSubscriberGauge(const CStatsSubscriberGauge&) = delete;
+    CStatsSubscriberGauge& operator=(const CStatsSubscriberGauge&) = delete;
+
+private:
+    CEventStatsSlot* slot_;
+};
+
+// Wraps one subscriber so its calls and latency land in its own slot
+// (allocate it with EStatsKind::Subscriber). The slot counts the subscriber
+// until the last copy of the wrapper is destroyed. A null slot returns
+// callback as is.
+template <typename... Args>
+std::function<void(Args...)> timed_subscriber(CEventStatsSlot* slot,
+        typename CStatsCallback<Args...>::Callback callback) {
+    if (!slot) return callback;
+    auto gauge = std::make_shared<CStatsSubscriberGauge>(slot);
+    return [slot, gauge, callback = std::move(callback)](Args... args) {
+        slot->count_trigger();
+        uint64_t start = CEventStatsSlot::now_ns();
+        callback(args...);
+        slot->record_latency(CEventStatsSlot::now_ns() - start);
+    };
+}
+
+// usage example
+/*
+auto g_stats = CEventStatsRegion::create("/devmon_events");
+
+auto onStatus = std::make_shared<CEventSafe<std::string>>();
+onStatus->set_stats(g_stats->allocate("onStatus"));
+
+CAsyncDispatcher guiQueue(1);
+guiQueue.set_stats(g_stats->allocate("guiQueue", EStatsKind::Dispatcher));
+
+auto guiSub = onStatus->subscribe(timed_subscriber<std::string>(
+    g_stats->allocate("onStatus/gui", EStatsKind::Subscriber),
+    [](std::string info) { gui.show(info); }));
+
+// from a shell, while the process runs:
+//   $ eventtop /devmon_events
+*/
+
+#endif
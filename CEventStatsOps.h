@@ -0,0 +1,74 @@
+/**************************************************************
+
+DESCRIPTION
+
+	This file defines CEventStatsOps, the table through which
+	events, timers and dispatchers update an attached
+	CEventStatsSlot.
+
+	CEventStatsSlot is only forward-declared here. set_stats()
+	installs the table from the caller, where the slot type is
+	complete, so only code that attaches stats needs
+	CEventStats.h and its POSIX shared memory.
+
+**************************************************************/
+
+
+#ifndef __CEventStatsOps_h__
+#define __CEventStatsOps_h__
+
+#include <chrono>
+#include <cstdint>
+
+struct CEventStatsSlot;     // CEventStats.h
+
+struct CEventStatsOps {
+    void (*count_trigger)(CEventStatsSlot*);
+    void (*count_drop)(CEventStatsSlot*);
+    void (*record_latency)(CEventStatsSlot*, uint64_t ns);
+    void (*add_subscribers)(CEventStatsSlot*, int64_t delta);
+    void (*set_queue_depth)(CEventStatsSlot*, int64_t n);
+
+    // Slot is CEventStatsSlot, deferred so it need be complete only at the caller.
+    template <typename Slot>
+    static const CEventStatsOps* of() {
+        static const CEventStatsOps ops = {
+            [](CEventStatsSlot* slot) { static_cast<Slot*>(slot)->count_trigger(); },
+            [](CEventStatsSlot* slot) { static_cast<Slot*>(slot)->count_drop(); },
+            [](CEventStatsSlot* slot, uint64_t ns) { static_cast<Slot*>(slot)->record_latency(ns); },
+            [](CEventStatsSlot* slot, int64_t delta) { static_cast<Slot*>(slot)->add_subscribers(delta); },
+            [](CEventStatsSlot* slot, int64_t n) { static_cast<Slot*>(slot)->set_queue_depth(n); }};
+        return &ops;
+    }
+
+    // The clock of CEventStatsSlot::now_ns().
+    static uint64_t now_ns() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+};
+
+// usage example
+/*
+// in a header that must not pull in CEventStats.h
+class CMyQueue {
+public:
+    template <typename Slot>
+    void set_stats(Slot* stats) {
+        static_assert(std::is_same<Slot, CEventStatsSlot>::value, "set_stats() takes a CEventStatsSlot");
+        ops_ = CEventStatsOps::of<Slot>();
+        stats_ = stats;
+    }
+
+    void push(int item) {
+        if (stats_) ops_->count_trigger(stats_);
+        ...
+    }
+
+private:
+    CEventStatsSlot* stats_ = nullptr;
+    const CEventStatsOps* ops_ = nullptr;
+};
+*/
+
+#endif
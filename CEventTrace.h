@@ -0,0 +1,367 @@
+/**************************************************************
+
+DESCRIPTION
+
+	This file defines a trace recorder and replayer for event
+	workloads.
+
+	CTraceRecorder captures subscribe, unsubscribe and trigger
+	calls as 16-byte records (time since start in us, event id,
+	op, subscriber id or payload bytes). CTracedEvent wraps a
+	CEventSafe and records every call made through it, so a
+	running process can be traced without touching the event
+	classes. Traces are saved to and loaded from a small binary
+	file.
+
+	CTraceReplayer drives an ITraceTarget with a trace, either as
+	fast as possible or honouring the recorded timing, and reports
+	throughput and trigger latency. CTraceTarget<EventT> adapts any
+	of the event templates carrying a std::string payload.
+
+**************************************************************/
+
+
+#ifndef __CEventTrace_h__
+#define __CEventTrace_h__
+
+#include "EventTemplate.h"
+#include "CEventCodec.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+enum class ETraceOp : uint8_t {
+    Subscribe = 1,
+    Unsubscribe = 2,
+    Trigger = 3,
+};
+
+struct CTraceRecord {
+    uint64_t time_us;   // since recording started
+    uint16_t event;
+    uint8_t op;         // ETraceOp
+    uint8_t reserved;
+    uint32_t value;     // subscriber id, or payload bytes for Trigger
+};
+static_assert(sizeof(CTraceRecord) == 16, "trace records are packed on disk");
+
+struct CTrace {
+    std::vector<std::string> events;    // event id -> name
+    std::vector<CTraceRecord> records;  // sorted by time_us
+
+    bool save(const std::string& path) const {
+        FILE* f = std::fopen(path.c_str(), "wb");
+        if (!f) return false;
+        bool ok = std::fwrite(kMagic, 1, sizeof(kMagic), f) == sizeof(kMagic);
+        uint32_t count = static_cast<uint32_t>(events.size());
+        ok = ok && std::fwrite(&count, sizeof(count), 1, f) == 1;
+        for (const auto& name : events) {
+            uint16_t len = static_cast<uint16_t>(std::min<size_t>(name.size(), 0xffff));
+            ok = ok && std::fwrite(&len, sizeof(len), 1, f) == 1
+                    && std::fwrite(name.data(), 1, len, f) == len;
+        }
+        count = static_cast<uint32_t>(records.size());
+        ok = ok && std::fwrite(&count, sizeof(count), 1, f) == 1
+                && std::fwrite(records.data(), sizeof(CTraceRecord), count, f) == count;
+        return std::fclose(f) == 0 && ok;
+    }
+
+    // Rejects files that are truncated or claim more records than they hold.
+    bool load(const std::string& path) {
+        std::unique_ptr<FILE, int (*)(FILE*)> file(std::fopen(path.c_str(), "rb"), &std::fclose);
+        if (!file) return false;
+        FILE* f = file.get();
+        char magic[sizeof(kMagic)];
+        uint32_t count = 0;
+        bool ok = std::fread(magic, 1, sizeof(magic), f) == sizeof(magic)
+               && std::memcmp(magic, kMagic, sizeof(magic)) == 0
+               && std::fread(&count, sizeof(count), 1, f) == 1;
+        events.clear();
+        for (uint32_t i = 0; ok && i < count; ++i) {
+            uint16_t len = 0;
+            ok = std::fread(&len, sizeof(len), 1, f) == 1;
+            std::string name(len, '\0');
+            ok = ok && std::fread(&name[0], 1, len, f) == len;
+            events.push_back(std::move(name));
+        }
+        ok = ok && std::fread(&count, sizeof(count), 1, f) == 1
+                && count <= remaining_bytes(f) / sizeof(CTraceRecord);
+        if (ok) {
+            records.resize(count);
+            ok = std::fread(records.data(), sizeof(CTraceRecord), count, f) == count;
+        }
+        return ok;
+    }
+
+    static constexpr char kMagic[8] = {'E', 'V', 'T', 'R', 'A', 'C', 'E', '2'};
+
+private:
+    static uint64_t remaining_bytes(FILE* f) {
+        long pos = std::ftell(f);
+        if (pos < 0 || std::fseek(f, 0, SEEK_END) != 0) return 0;
+        long end = std::ftell(f);
+        if (std::fseek(f, pos, SEEK_SET) != 0 || end < pos) return 0;
+        return static_cast<uint64_t>(end - pos);
+    }
+};
+
+// Records into a preallocated buffer; recording stops silently when it is full.
+class CTraceRecorder {
+public:
+    explicit CTraceRecorder(size_t capacity = 1 << 20)
+        : records_(capacity), start_(std::chrono::steady_clock::now()) {}
+
+    uint16_t register_event(const std::string& name) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        events_.push_back(name);
+        return static_cast<uint16_t>(events_.size() - 1);
+    }
+
+    uint32_t next_subscriber_id() { return nextSubscriber_.fetch_add(1, std::memory_order_relaxed); }
+
+    void record(ETraceOp op, uint16_t event, uint32_t value) {
+        size_t slot = next_.fetch_add(1, std::memory_order_relaxed);
+        if (slot >= records_.size()) return;
+        auto us = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start_).count();
+        records_[slot] = CTraceRecord{static_cast<uint64_t>(us), event, static_cast<uint8_t>(op), 0, value};
+        written_.fetch_add(1, std::memory_order_release);
+    }
+
+    bool full() const { return next_.load(std::memory_order_relaxed) >= records_.size(); }
+
+    // Call once recording threads are quiet.
+    CTrace snapshot() const {
+        CTrace trace;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            trace.events = events_;
+        }
+        size_t count = std::min(written_.load(std::memory_order_acquire), records_.size());
+        trace.records.assign(records_.begin(), records_.begin() + count);
+        std::stable_sort(trace.records.begin(), trace.records.end(),
+            [](const CTraceRecord& a, const CTraceRecord& b) { return a.time_us < b.time_us; });
+        return trace;
+    }
+
+private:
+    mutable std::mutex mutex_;
+    std::vector<std::string> events_;
+    std::vector<CTraceRecord> records_;
+    std::atomic<size_t> next_{0};
+    std::atomic<size_t> written_{0};
+    std::atomic<uint32_t> nextSubscriber_{0};
+    std::chrono::steady_clock::time_point start_;
+};
+
+// CEventSafe front end that records every subscribe, unsubscribe and trigger.
+template <typename... Args>
+class CTracedEvent {
+public:
+    using Event = CEventSafe<Args...>;
+    using Callback = typename Event::Callback;
+
+    class Subscription {
+    public:
+        Subscription(typename Event::Subscription inner, CTraceRecorder* recorder, uint16_t event, uint32_t id)
+            : inner_(std::move(inner)), recorder_(recorder), event_(event), id_(id) {}
+        ~Subscription() {
+            if (recorder_) recorder_->record(ETraceOp::Unsubscribe, event_, id_);
+        }
+        Subscription(Subscription&& other) noexcept
+            : inner_(std::move(other.inner_)), recorder_(other.recorder_), event_(other.event_), id_(other.id_) {
+            other.recorder_ = nullptr;
+        }
+        Subscription(const Subscription&) = delete;
+        Subscription& operator=(const Subscription&) = delete;
+    private:
+        typename Event::Subscription inner_;
+        CTraceRecorder* recorder_;
+        uint16_t event_;
+        uint32_t id_;
+    };
+
+    CTracedEvent(std::shared_ptr<Event> event, CTraceRecorder& recorder, const std::string& name)
+        : event_(std::move(event)), recorder_(recorder), id_(recorder.register_event(name)) {}
+
+    Subscription subscribe(Callback callback) {
+        uint32_t sub = recorder_.next_subscriber_id();
+        recorder_.record(ETraceOp::Subscribe, id_, sub);
+        return Subscription(event_->subscribe(std::move(callback)), &recorder_, id_, sub);
+    }
+
+    void trigger(Args... args) {
+        size_t bytes = (size_t(0) + ... + CCodecTraits<std::decay_t<Args>>::size(args));
+        recorder_.record(ETraceOp::Trigger, id_, static_cast<uint32_t>(bytes));
+        event_->trigger(args...);
+    }
+
+    const std::shared_ptr<Event>& event() const { return event_; }
+
+private:
+    std::shared_ptr<Event> event_;
+    CTraceRecorder& recorder_;
+    uint16_t id_;
+};
+
+// What the replayer drives. Subscriber ids are unique across the trace.
+class ITraceTarget {
+public:
+    virtual ~ITraceTarget() = default;
+    virtual void subscribe(uint16_t event, uint32_t subscriber) = 0;
+    virtual void unsubscribe(uint16_t event, uint32_t subscriber) = 0;
+    virtual void trigger(uint16_t event, uint32_t payload_bytes) = 0;
+};
+
+// Adapts CSimpleEvent, CGlobalEvent, CEvent or CEventSafe<std::string>.
+// Events without unsubscribe keep their subscribers until the target dies.
+template <typename EventT>
+class CTraceTarget : public ITraceTarget {
+public:
+    void subscribe(uint16_t event, uint32_t subscriber) override {
+        auto& ev = event_at(event);
+        auto callback = [this](std::string payload) {
+            bytesDelivered_ += payload.size();
+        };
+        using Result = decltype(ev->subscribe(callback));
+        if constexpr (std::is_void<Result>::value) {
+            ev->subscribe(callback);
+        } else {
+            holders_.emplace(subscriber, std::make_unique<Holder<Result>>(ev->subscribe(callback)));
+        }
+    }
+
+    void unsubscribe(uint16_t, uint32_t subscriber) override {
+        holders_.erase(subscriber);
+    }
+
+    void trigger(uint16_t event, uint32_t payload_bytes) override {
+        if (payload_.size() != payload_bytes) payload_.assign(payload_bytes, 'x');
+        event_at(event)->trigger(payload_);
+    }
+
+    size_t bytes_delivered() const { return bytesDelivered_; }
+
+private:
+    struct HolderBase {
+        virtual ~HolderBase() = default;
+    };
+    template <typename Sub>
+    struct Holder : HolderBase {
+        explicit Holder(Sub s) : sub(std::move(s)) {}
+        Sub sub;
+    };
+
+    std::shared_ptr<EventT>& event_at(uint16_t event) {
+        if (event >= events_.size()) events_.resize(event + 1);
+        if (!events_[event]) events_[event] = std::make_shared<EventT>();
+        return events_[event];
+    }
+
+    std::vector<std::shared_ptr<EventT>> events_;
+    std::unordered_map<uint32_t, std::unique_ptr<HolderBase>> holders_;
+    std::string payload_;
+    size_t bytesDelivered_ = 0;
+};
+
+struct CReplayReport {
+    size_t operations = 0;
+    size_t triggers = 0;
+    double elapsed_s = 0;
+    double triggers_per_s = 0;
+    uint64_t p50_ns = 0;
+    uint64_t p99_ns = 0;
+    uint64_t max_ns = 0;
+};
+
+class CTraceReplayer {
+public:
+    explicit CTraceReplayer(const CTrace& trace) : trace_(trace) {}
+
+    // speed > 0 replays with recorded gaps scaled by 1/speed; 0 means flat out.
+    CReplayReport run(ITraceTarget& target, double speed = 0) const {
+        using Clock = std::chrono::steady_clock;
+        CReplayReport report;
+        std::vector<uint64_t> latencies;
+        latencies.reserve(trace_.records.size());
+
+        auto start = Clock::now();
+        uint64_t first_us = trace_.records.empty() ? 0 : trace_.records.front().time_us;
+        for (const auto& rec : trace_.records) {
+            if (speed > 0) {
+                auto due = start + std::chrono::microseconds(
+                    static_cast<int64_t>((rec.time_us - first_us) / speed));
+                std::this_thread::sleep_until(due);
+            }
+            switch (static_cast<ETraceOp>(rec.op)) {
+            case ETraceOp::Subscribe:
+                target.subscribe(rec.event, rec.value);
+                break;
+            case ETraceOp::Unsubscribe:
+                target.unsubscribe(rec.event, rec.value);
+                break;
+            case ETraceOp::Trigger: {
+                auto t0 = Clock::now();
+                target.trigger(rec.event, rec.value);
+                latencies.push_back(static_cast<uint64_t>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t0).count()));
+                break;
+            }
+            default:
+                continue;
+            }
+            ++report.operations;
+        }
+        report.elapsed_s = std::chrono::duration<double>(Clock::now() - start).count();
+
+        report.triggers = latencies.size();
+        if (report.elapsed_s > 0) report.triggers_per_s = report.triggers / report.elapsed_s;
+        if (!latencies.empty()) {
+            report.p50_ns = percentile(latencies, 0.50);
+            report.p99_ns = percentile(latencies, 0.99);
+            report.max_ns = *std::max_element(latencies.begin(), latencies.end());
+        }
+        return report;
+    }
+
+private:
+    static uint64_t percentile(std::vector<uint64_t>& values, double q) {
+        size_t index = std::min(values.size() - 1, static_cast<size_t>(q * values.size()));
+        std::nth_element(values.begin(), values.begin() + index, values.end());
+        return values[index];
+    }
+
+    const CTrace& trace_;
+};
+
+// usage example
+/*
+// in production: route the hot events through a recorder
+CTraceRecorder recorder;
+CTracedEvent<std::string> onStatus(std::make_shared<CEventSafe<std::string>>(), recorder, "status");
+auto sub = onStatus.subscribe([](std::string s) { std::cout << s << std::endl; });
+onStatus.trigger("Dev_7 Ok");
+recorder.snapshot().save("status.trace");
+
+// offline: compare event classes on the real mix
+CTrace trace;
+trace.load("status.trace");
+CTraceTarget<CEventSafe<std::string>> safe;
+CTraceTarget<CEvent<std::string>> plain;
+auto a = CTraceReplayer(trace).run(safe);
+auto b = CTraceReplayer(trace).run(plain);
+std::cout << a.triggers_per_s << " vs " << b.triggers_per_s << " triggers/s, p99 "
+          << a.p99_ns << " vs " << b.p99_ns << " ns" << std::endl;
+*/
+
+#endif
@@ -0,0 +1,164 @@
+/**************************************************************
+
+DESCRIPTION
+
+	This file defines CEventTree, hierarchical events that bubble
+	from a node up through its ancestors, e.g. device -> rack ->
+	site -> global.
+
+	Every node owns a CEvent. A trigger on a node runs that node's
+	subscribers, then its parent's, and so on up to the root, all
+	in one call with the same arguments. Any level can stop the
+	bubbling: a handler subscribed with subscribe_handler() that
+	returns EEventResult::Handled ends it after that handler (as
+	in CEvent::trigger_until()).
+
+	Each node caches its path to the root. The cache is keyed by
+	a structure version that only reparent() changes. Adding
+	nodes leaves existing paths valid, so triggering never walks
+	parent links except on the first trigger after a change.
+
+	Like CEvent, the tree is meant for one thread.
+
+**************************************************************/
+
+
+#ifndef __CEventTree_h__
+#define __CEventTree_h__
+
+#include "EventTemplate.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+template <typename... Args>
+class CEventTree {
+public:
+    using Event = CEvent<Args...>;
+    using Callback = typename Event::Callback;
+    using Handler = typename Event::Handler;
+    using Subscription = typename Event::Subscription;
+
+    static constexpr size_t kNone = SIZE_MAX;
+
+    // Returns the new node's id. parent must be kNone (a root) or an existing node.
+    size_t add_node(std::string name, size_t parent = kNone) {
+        if (parent != kNone && parent >= nodes_.size()) return kNone;
+        Node node;
+        node.name = std::move(name);
+        node.parent = parent;
+        node.event = std::make_shared<Event>();
+        nodes_.push_back(std::move(node));
+        return nodes_.size() - 1;
+    }
+
+    // Moves node (and its subtree) under parent; kNone makes it a root.
+    // False if either node does not exist or the move would create a cycle.
+    bool reparent(size_t node, size_t parent) {
+        if (node >= nodes_.size() || (parent != kNone && parent >= nodes_.size())) return false;
+        for (size_t up = parent; up != kNone; up = nodes_[up].parent) {
+            if (up == node) return false;
+        }
+        if (nodes_[node].parent == parent) return true;
+        nodes_[node].parent = parent;
+        ++version_;
+        return true;
+    }
+
+    // node must be an id returned by add_node().
+    Subscription subscribe(size_t node, Callback callback) {
+        return nodes_[node].event->subscribe(std::move(callback));
+    }
+
+    // Returning Handled stops the bubbling after this handler.
+    Subscription subscribe_handler(size_t node, Handler handler) {
+        return nodes_[node].event->subscribe_handler(std::move(handler));
+    }
+
+    // Delivers on node, then on each ancestor. Returns the node whose
+    // handler stopped propagation, or kNone if it reached the root.
+    size_t trigger(size_t node, Args... args) {
+        if (node >= nodes_.size()) return kNone;
+        // Holding the path keeps it (and its events) alive if a handler
+        // changes the tree during the walk.
+        std::shared_ptr<const Path> path = cached_path(node);
+        for (const Level& level : *path) {
+            if (level.event->trigger_until(args...) != -1) return level.node;
+        }
+        return kNone;
+    }
+
+    // node first, root last.
+    std::vector<size_t> path(size_t node) {
+        std::vector<size_t> ids;
+        if (node >= nodes_.size()) return ids;
+        for (const Level& level : *cached_path(node)) ids.push_back(level.node);
+        return ids;
+    }
+
+    size_t parent(size_t node) const { return node < nodes_.size() ? nodes_[node].parent : kNone; }
+    const std::string& name(size_t node) const { return nodes_[node].name; }
+    size_t size() const { return nodes_.size(); }
+
+    // Changes whenever the parent links do; cached paths older than it are rebuilt.
+    uint64_t version() const { return version_; }
+
+private:
+    struct Level {
+        size_t node;
+        std::shared_ptr<Event> event;
+    };
+    using Path = std::vector<Level>;
+
+    struct Node {
+        std::string name;
+        size_t parent = kNone;
+        std::shared_ptr<Event> event;
+        std::shared_ptr<const Path> path;
+        uint64_t pathVersion = 0;
+    };
+
+    std::shared_ptr<const Path> cached_path(size_t node) {
+        Node& start = nodes_[node];
+        if (!start.path || start.pathVersion != version_) {
+            auto path = std::make_shared<Path>();
+            for (size_t up = node; up != kNone; up = nodes_[up].parent) {
+                path->push_back(Level{up, nodes_[up].event});
+            }
+            start.path = std::move(path);
+            start.pathVersion = version_;
+        }
+        return start.path;
+    }
+
+    std::vector<Node> nodes_;
+    uint64_t version_ = 1;
+};
+
+// usage example
+/*
+CEventTree<int, std::string> g_devTree;      // device id, status
+size_t global = g_devTree.add_node("global");
+size_t site = g_devTree.add_node("site-A", global);
+size_t rack = g_devTree.add_node("rack-07", site);
+size_t dev = g_devTree.add_node("dev-42", rack);
+
+auto rackSub = g_devTree.subscribe(rack, [](int devId, std::string info) {
+    rackPanel.update(devId, info);
+});
+// maintenance: a site in maintenance swallows alarms before they reach global
+auto siteSub = g_devTree.subscribe_handler(site, [](int, std::string) {
+    return g_bMaintenance ? EEventResult::Handled : EEventResult::Continue;
+});
+auto globalSub = g_devTree.subscribe(global, [](int devId, std::string info) {
+    g_pLog->LogInfo(LOG_SYS, info.c_str());
+});
+
+g_devTree.trigger(dev, 42, "Down");          // dev-42, rack-07, site-A, global
+g_devTree.reparent(rack, otherSite);         // paths rebuild on their next trigger
+*/
+
+#endif
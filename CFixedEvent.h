@@ -0,0 +1,406 @@
+/**************************************************************
+
+DESCRIPTION
+
+	This file defines CFixedEvent and CFixedEventSafe, heap-free
+	event variants for real-time threads.
+
+	Subscribers live in a std::array of N slots and callbacks are
+	stored in CInplaceFunction, a fixed-size callable that rejects
+	(at compile time) anything not fitting its buffer. Nothing is
+	allocated after construction: subscribe, trigger and
+	unsubscribe only touch the arrays.
+
+	Subscribing to a full event returns an invalid Subscription
+	(test it with if (sub)) and counts a rejection. Subscriptions
+	hold a raw pointer to the event, so the event must outlive
+	them; a generation number keeps a stale Subscription from
+	releasing a reused slot.
+
+**************************************************************/
+
+
+#ifndef __CFixedEvent_h__
+#define __CFixedEvent_h__
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Default callable buffer: a lambda capturing up to four pointers.
+constexpr size_t kInplaceCallableSize = 4 * sizeof(void*);
+
+template <typename Signature, size_t Capacity = kInplaceCallableSize>
+class CInplaceFunction;
+
+template <typename R, typename... Args, size_t Capacity>
+class CInplaceFunction<R(Args...), Capacity> {
+public:
+    CInplaceFunction() = default;
+
+    template <typename F, typename = std::enable_if_t<!std::is_same<std::decay_t<F>, CInplaceFunction>::value>>
+    CInplaceFunction(F&& f) {
+        using Fn = std::decay_t<F>;
+        static_assert(sizeof(Fn) <= Capacity, "callable too large for CInplaceFunction; capture less or raise Capacity");
+        static_assert(alignof(Fn) <= alignof(std::max_align_t), "callable over-aligned for CInplaceFunction");
+        static_assert(std::is_nothrow_move_constructible<Fn>::value, "callable must be nothrow movable");
+        new (&storage_) Fn(std::forward<F>(f));
+        invoke_ = [](void* p, Args... args) -> R { return (*static_cast<Fn*>(p))(std::forward<Args>(args)...); };
+        manage_ = [](void* dst, void* src) {
+            if (src) new (dst) Fn(std::move(*static_cast<Fn*>(src)));
+            static_cast<Fn*>(src ? src : dst)->~Fn();
+        };
+    }
+
+    CInplaceFunction(CInplaceFunction&& other) noexcept { move_from(other); }
+
+    CInplaceFunction& operator=(CInplaceFunction&& other) noexcept {
+        if (this != &other) {
+            reset();
+            move_from(other);
+        }
+        return *this;
+    }
+
+    CInplaceFunction(const CInplaceFunction&) = delete;
+    CInplaceFunction& operator=(const CInplaceFunction&) = delete;
+
+    ~CInplaceFunction() { reset(); }
+
+    R operator()(Args... args) const { return invoke_(&storage_, std::forward<Args>(args)...); }
+
+    explicit operator bool() const { return invoke_ != nullptr; }
+
+    void reset() {
+        if (manage_) manage_(&storage_, nullptr);
+        invoke_ = nullptr;
+        manage_ = nullptr;
+    }
+
+private:
+    // manage_(dst, src) move-constructs dst from src and destroys src;
+    // manage_(p, nullptr) destroys p.
+    using Invoke = R (*)(void*, Args...);
+    using Manage = void (*)(void*, void*);
+
+    void move_from(CInplaceFunction& other) {
+        if (other.manage_) other.manage_(&storage_, &other.storage_);
+        invoke_ = other.invoke_;
+        manage_ = other.manage_;
+        other.invoke_ = nullptr;
+        other.manage_ = nullptr;
+    }
+
+    mutable std::aligned_storage_t<Capacity, alignof(std::max_align_t)> storage_;
+    Invoke invoke_ = nullptr;
+    Manage manage_ = nullptr;
+};
+
+// Single-threaded: subscribe, trigger and unsubscribe from one thread.
+template <size_t N, size_t CallableSize, typename... Args>
+class CFixedEventEx {
+    static_assert(N > 0 && N < 0xFFFF, "CFixedEvent capacity must be 1..65534");
+public:
+    using Callback = CInplaceFunction<void(Args...), CallableSize>;
+
+    class Subscription {
+        friend class CFixedEventEx;
+    public:
+        Subscription() = default;
+        ~Subscription() {
+            if (event_) event_->unsubscribe(slot_, generation_);
+        }
+
+        Subscription(Subscription&& other) noexcept
+            : event_(other.event_), slot_(other.slot_), generation_(other.generation_) {
+            other.event_ = nullptr;
+        }
+
+        Subscription& operator=(Subscription&& other) noexcept {
+            if (this != &other) {
+                if (event_) event_->unsubscribe(slot_, generation_);
+                event_ = other.event_;
+                slot_ = other.slot_;
+                generation_ = other.generation_;
+                other.event_ = nullptr;
+            }
+            return *this;
+        }
+
+        Subscription(const Subscription&) = delete;
+        Subscription& operator=(const Subscription&) = delete;
+
+        // False when subscribe() found no free slot.
+        explicit operator bool() const { return event_ != nullptr; }
+
+    private:
+        Subscription(CFixedEventEx* event, uint16_t slot, uint32_t generation)
+            : event_(event), slot_(slot), generation_(generation) {}
+
+        CFixedEventEx* event_ = nullptr;
+        uint16_t slot_ = 0;
+        uint32_t generation_ = 0;
+    };
+
+    CFixedEventEx() = default;
+    CFixedEventEx(const CFixedEventEx&) = delete;
+    CFixedEventEx& operator=(const CFixedEventEx&) = delete;
+
+    [[nodiscard]] Subscription subscribe(Callback callback) {
+        if (count_ == N && depth_ == 0) cleanup();
+        if (count_ == N) {
+            ++rejected_;
+            return Subscription();
+        }
+        uint16_t slot = free_slot();
+        slots_[slot].callback = std::move(callback);
+        slots_[slot].active = true;
+        order_[count_++] = slot;
+        return Subscription(this, slot, slots_[slot].generation);
+    }
+
+    // Subscribers run in subscription order; ones added during trigger wait for the next.
+    void trigger(Args... args) {
+        if (depth_ == 0) cleanup();
+        ++depth_;
+        size_t count = count_;
+        for (size_t i = 0; i < count; ++i) {
+            Slot& slot = slots_[order_[i]];
+            if (slot.active) slot.callback(args...);
+        }
+        --depth_;
+    }
+
+    size_t size() const { return count_; }
+    static constexpr size_t capacity() { return N; }
+    unsigned long rejected() const { return rejected_; }
+
+private:
+    struct Slot {
+        Callback callback;
+        uint32_t generation = 0;
+        bool active = false;
+        bool used = false;      // holds a subscriber (possibly waiting for cleanup)
+    };
+
+    uint16_t free_slot() {
+        for (uint16_t i = 0; i < N; ++i) {
+            if (!slots_[i].used) {
+                slots_[i].used = true;
+                return i;
+            }
+        }
+        return 0;   // unreachable: count_ < N
+    }
+
+    void unsubscribe(uint16_t slot, uint32_t generation) {
+        if (slots_[slot].generation == generation && slots_[slot].active) {
+            slots_[slot].active = false;
+            needsCleanup_ = true;
+        }
+    }
+
+    // Releases unsubscribed slots; deferred to here so trigger never frees a running callback.
+    void cleanup() {
+        if (!needsCleanup_) return;
+        size_t kept = 0;
+        for (size_t i = 0; i < count_; ++i) {
+            Slot& slot = slots_[order_[i]];
+            if (slot.active) {
+                order_[kept++] = order_[i];
+            } else {
+                slot.callback.reset();
+                slot.used = false;
+                ++slot.generation;
+            }
+        }
+        count_ = kept;
+        needsCleanup_ = false;
+    }
+
+    std::array<Slot, N> slots_;
+    std::array<uint16_t, N> order_{};
+    size_t count_ = 0;
+    unsigned int depth_ = 0;    // nested triggers; order_ is only compacted at depth 0
+    bool needsCleanup_ = false;
+    unsigned long rejected_ = 0;
+};
+
+// Thread-safe: the lock is held only to pick and pin slots, never while calling
+// subscribers. An unsubscribed slot still running elsewhere is released by the
+// trigger that finishes with it, so unsubscribe never blocks.
+template <size_t N, size_t CallableSize, typename... Args>
+class CFixedEventSafeEx {
+    static_assert(N > 0 && N < 0xFFFF, "CFixedEventSafe capacity must be 1..65534");
+public:
+    using Callback = CInplaceFunction<void(Args...), CallableSize>;
+
+    class Subscription {
+        friend class CFixedEventSafeEx;
+    public:
+        Subscription() = default;
+        ~Subscription() {
+            if (event_) event_->unsubscribe(slot_, generation_);
+        }
+
+        Subscription(Subscription&& other) noexcept
+            : event_(other.event_), slot_(other.slot_), generation_(other.generation_) {
+            other.event_ = nullptr;
+        }
+
+        Subscription& operator=(Subscription&& other) noexcept {
+            if (this != &other) {
+                if (event_) event_->unsubscribe(slot_, generation_);
+                event_ = other.event_;
+                slot_ = other.slot_;
+                generation_ = other.generation_;
+                other.event_ = nullptr;
+            }
+            return *this;
+        }
+
+        Subscription(const Subscription&) = delete;
+        Subscription& operator=(const Subscription&) = delete;
+
+        explicit operator bool() const { return event_ != nullptr; }
+
+    private:
+        Subscription(CFixedEventSafeEx* event, uint16_t slot, uint32_t generation)
+            : event_(event), slot_(slot), generation_(generation) {}
+
+        CFixedEventSafeEx* event_ = nullptr;
+        uint16_t slot_ = 0;
+        uint32_t generation_ = 0;
+    };
+
+    CFixedEventSafeEx() = default;
+    CFixedEventSafeEx(const CFixedEventSafeEx&) = delete;
+    CFixedEventSafeEx& operator=(const CFixedEventSafeEx&) = delete;
+
+    [[nodiscard]] Subscription subscribe(Callback callback) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (count_ == N) {
+            ++rejected_;
+            return Subscription();
+        }
+        uint16_t slot = N;
+        for (uint16_t i = 0; i < N; ++i) {
+            if (!slots_[i].used) {
+                slot = i;
+                break;
+            }
+        }
+        if (slot == N) {
+            // Every free index is still pinned by a running trigger.
+            ++rejected_;
+            return Subscription();
+        }
+        slots_[slot].callback = std::move(callback);
+        slots_[slot].used = true;
+        slots_[slot].active = true;
+        order_[count_++] = slot;
+        return Subscription(this, slot, slots_[slot].generation);
+    }
+
+    void trigger(Args... args) {
+        std::array<uint16_t, N> pinned;
+        size_t count = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (size_t i = 0; i < count_; ++i) {
+                Slot& slot = slots_[order_[i]];
+                ++slot.busy;
+                pinned[count++] = order_[i];
+            }
+        }
+        for (size_t i = 0; i < count; ++i) {
+            Slot& slot = slots_[pinned[i]];
+            if (slot.active.load(std::memory_order_acquire)) slot.callback(args...);
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (size_t i = 0; i < count; ++i) {
+            Slot& slot = slots_[pinned[i]];
+            if (--slot.busy == 0 && !slot.active.load(std::memory_order_relaxed)) release(slot);
+        }
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return count_;
+    }
+    static constexpr size_t capacity() { return N; }
+    unsigned long rejected() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return rejected_;
+    }
+
+private:
+    struct Slot {
+        Callback callback;
+        uint32_t generation = 0;
+        unsigned int busy = 0;              // triggers currently holding this slot
+        std::atomic<bool> active{false};    // read outside the lock by trigger
+        bool used = false;
+    };
+
+    void unsubscribe(uint16_t slot, uint32_t generation) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Slot& entry = slots_[slot];
+        if (entry.generation != generation || !entry.active.load(std::memory_order_relaxed)) return;
+        entry.active.store(false, std::memory_order_release);
+        size_t kept = 0;
+        for (size_t i = 0; i < count_; ++i) {
+            if (order_[i] != slot) order_[kept++] = order_[i];
+        }
+        count_ = kept;
+        if (entry.busy == 0) release(entry);
+    }
+
+    // Caller holds mutex_.
+    void release(Slot& slot) {
+        slot.callback.reset();
+        slot.used = false;
+        ++slot.generation;
+    }
+
+    mutable std::mutex mutex_;
+    std::array<Slot, N> slots_;
+    std::array<uint16_t, N> order_{};
+    size_t count_ = 0;
+    unsigned long rejected_ = 0;
+};
+
+template <size_t N, typename... Args>
+using CFixedEvent = CFixedEventEx<N, kInplaceCallableSize, Args...>;
+
+template <size_t N, typename... Args>
+using CFixedEventSafe = CFixedEventSafeEx<N, kInplaceCallableSize, Args...>;
+
+// usage example
+/*
+// control loop thread: no malloc after startup
+CFixedEventSafe<8, int, double> g_onAxisUpdate;
+
+CAxisLogger::CAxisLogger()
+    : m_sub(g_onAxisUpdate.subscribe([this](int axis, double pos) { Record(axis, pos); }))
+{
+    if (!m_sub) {
+        g_pLog->LogInfo(LOG_SYS, "axis logger: g_onAxisUpdate is full");
+    }
+}
+
+void CAxis::Tick()
+{
+    g_onAxisUpdate.trigger(m_nId, m_dPos);   // no allocation, no std::function
+}
+
+// a bigger capture needs a bigger buffer
+CFixedEventEx<4, 64, std::string> onBigCapture;
+*/
+
+#endif
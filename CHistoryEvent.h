@@ -0,0 +1,233 @@
+/**************************************************************
+
+DESCRIPTION
+
+	This file defines CHistoryEvent, a thread-safe event that
+	remembers its last N triggers and replays them to each new
+	subscriber, so late components (e.g. GUI panels) see recent
+	status without querying it separately.
+
+	The history is a preallocated ring of N argument tuples;
+	trigger assigns into the next slot, so once the slots hold
+	their largest payloads no further allocation happens. The
+	ring is written inside the same short critical section that
+	snapshots the subscribers (as in CEventSafe), which is also
+	where a new subscriber is published together with its copy
+	of the history. Live triggers that reach a subscriber still
+	replaying - from any thread, including its own callback -
+	are queued on it and delivered by the replaying thread after
+	the history, so every subscriber sees each trigger exactly
+	once and no trigger blocks on another subscriber's replay.
+	If the callback throws during replay the subscription is
+	dropped and the exception propagates out of subscribe().
+
+**************************************************************/
+
+
+#ifndef __CHistoryEvent_h__
+#define __CHistoryEvent_h__
+
+#include <algorithm>
+#include <array>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+template <size_t N, typename... Args>
+class CHistoryEvent : public std::enable_shared_from_this<CHistoryEvent<N, Args...>> {
+    static_assert(N > 0, "history needs at least one slot");
+public:
+    using Callback = std::function<void(Args...)>;
+
+    class Subscription {
+        friend class CHistoryEvent;
+    public:
+        ~Subscription() {
+            if (auto event = event_.lock()) {
+                event->unsubscribe(id_);
+            }
+        }
+
+        Subscription(Subscription&& other) noexcept
+            : event_(std::move(other.event_)), id_(other.id_) {
+            other.id_ = -1;
+        }
+
+        Subscription& operator=(Subscription&& other) noexcept {
+            if (this != &other) {
+                event_ = std::move(other.event_);
+                id_ = other.id_;
+                other.id_ = -1;
+            }
+            return *this;
+        }
+
+        Subscription(const Subscription&) = delete;
+        Subscription& operator=(const Subscription&) = delete;
+
+    private:
+        Subscription(std::weak_ptr<CHistoryEvent> event, int id)
+            : event_(std::move(event)), id_(id) {}
+
+        std::weak_ptr<CHistoryEvent> event_;
+        int id_ = -1;
+    };
+
+    // Replays up to N past triggers (oldest first) on the calling thread
+    // before returning; later triggers are delivered live.
+    Subscription subscribe(Callback callback) {
+        std::weak_ptr<CHistoryEvent> weakSelf = this->shared_from_this();
+        std::vector<Stored> backlog;
+        auto entry = std::make_shared<CallbackEntry>(-1, std::move(callback));
+        entry->replaying = true;
+        int id;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            id = entry->id = nextId_++;
+            callbacks_.push_back(entry);
+
+            size_t count = std::min<size_t>(head_, N);
+            backlog.reserve(count);
+            for (size_t seq = head_ - count; seq < head_; ++seq) {
+                backlog.push_back(*history_[seq % N]);
+            }
+        }
+
+        try {
+            for (const auto& args : backlog) {
+                std::apply(entry->callback, args);
+            }
+            // Triggers queued during the replay, in order; each may queue more.
+            std::vector<Stored> pending;
+            for (;;) {
+                {
+                    std::lock_guard<std::mutex> lock(entry->deferMutex);
+                    if (entry->deferred.empty()) {
+                        entry->replaying = false;
+                        break;
+                    }
+                    pending.swap(entry->deferred);
+                }
+                for (const auto& args : pending) {
+                    std::apply(entry->callback, args);
+                }
+                pending.clear();
+            }
+        } catch (...) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                entry->active = false;
+                needsCleanup_ = true;
+            }
+            std::lock_guard<std::mutex> lock(entry->deferMutex);
+            entry->replaying = false;
+            entry->deferred.clear();
+            throw;
+        }
+        return Subscription(std::move(weakSelf), id);
+    }
+
+    void trigger(Args... args) {
+        std::vector<std::shared_ptr<CallbackEntry>> activeEntries;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            // Assign into a used slot so its payload buffers are reused.
+            std::optional<Stored>& slot = history_[head_ % N];
+            if (slot) *slot = std::forward_as_tuple(args...);
+            else slot.emplace(args...);
+            ++head_;
+
+            if (needsCleanup_) {
+                callbacks_.erase(
+                    std::remove_if(callbacks_.begin(), callbacks_.end(),
+                        [](const std::shared_ptr<CallbackEntry>& entry) {
+                            return !entry->active;
+                        }),
+                    callbacks_.end());
+                needsCleanup_ = false;
+            }
+            activeEntries.reserve(callbacks_.size());
+            for (auto& entry : callbacks_) {
+                if (entry->active) {
+                    activeEntries.push_back(entry);
+                }
+            }
+        }
+
+        for (auto& entry : activeEntries) {
+            {
+                // Subscriber is still catching up: its replaying thread
+                // delivers this after the history.
+                std::lock_guard<std::mutex> lock(entry->deferMutex);
+                if (entry->replaying) {
+                    entry->deferred.emplace_back(args...);
+                    continue;
+                }
+            }
+            entry->callback(args...);
+        }
+    }
+
+    // Number of triggers currently held for replay (at most N).
+    size_t history_size() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return std::min<size_t>(head_, N);
+    }
+
+    void clear_history() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        head_ = 0;
+    }
+
+private:
+    using Stored = std::tuple<std::decay_t<Args>...>;
+
+    struct CallbackEntry {
+        int id;
+        Callback callback;
+        bool active;
+        std::mutex deferMutex;          // guards replaying and deferred
+        bool replaying = false;
+        std::vector<Stored> deferred;
+
+        CallbackEntry(int id, Callback callback, bool active = true)
+            : id(id), callback(std::move(callback)), active(active) {}
+    };
+
+    void unsubscribe(int id) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = std::find_if(callbacks_.begin(), callbacks_.end(),
+            [id](const std::shared_ptr<CallbackEntry>& entry) {
+                return entry->id == id;
+            });
+        if (it != callbacks_.end()) {
+            (*it)->active = false;
+            needsCleanup_ = true;
+        }
+    }
+
+    mutable std::mutex mutex_;
+    bool needsCleanup_ = false;
+    int nextId_ = 0;
+    std::vector<std::shared_ptr<CallbackEntry>> callbacks_;
+    std::array<std::optional<Stored>, N> history_{};   // no default constructor needed
+    size_t head_ = 0;  // total triggers stored; next slot is head_ % N
+};
+
+// usage example
+/*
+auto onStatus = std::make_shared<CHistoryEvent<16, std::string>>();
+onStatus->trigger("Dev_1 Ok");
+onStatus->trigger("Dev_2 Down");
+
+// GUI panel opened later: gets both lines first, then live updates
+auto sub = onStatus->subscribe([](std::string info) {
+    std::cout << "status: " << info << std::endl;
+});
+*/
+
+#endif
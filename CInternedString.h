@@ -0,0 +1,217 @@
+/**************************************************************
+
+DESCRIPTION
+
+	This file defines CIString, an interned string handle for
+	event payloads such as status texts, and the lock-free
+	CInternTable behind it.
+
+	A CIString is one pointer to an immutable table entry: copying
+	it is free, == compares pointers, and hashing reads the stored
+	hash. Entries are never freed (no refcounts), so the table
+	only suits a bounded vocabulary like "Dev_7 Ok"/"Dev_7 Down".
+
+	Lookups probe fixed-size open-addressing segments; inserts
+	publish a new entry with one CAS. When the probe window of a
+	segment is exhausted, the table chains a segment twice as
+	large. Slots are never emptied, so all threads agree on where
+	a given string lives.
+
+**************************************************************/
+
+
+#ifndef __CInternedString_h__
+#define __CInternedString_h__
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+struct CInternEntry {
+    size_t hash;
+    uint32_t size;
+    char data[1];   // size bytes plus terminator, allocated in place
+
+    std::string_view view() const { return std::string_view(data, size); }
+};
+
+class CInternTable {
+public:
+    explicit CInternTable(size_t initial_slots = 4096) : head_(new Segment(round_up_pow2(initial_slots))) {}
+
+    ~CInternTable() {
+        Segment* segment = head_;
+        while (segment) {
+            for (size_t i = 0; i < segment->capacity; ++i) {
+                ::operator delete(segment->slots[i].load(std::memory_order_relaxed));
+            }
+            Segment* next = segment->next.load(std::memory_order_relaxed);
+            delete segment;
+            segment = next;
+        }
+    }
+
+    CInternTable(const CInternTable&) = delete;
+    CInternTable& operator=(const CInternTable&) = delete;
+
+    // Returns the one entry for text, inserting it on first use.
+    const CInternEntry* intern(std::string_view text) {
+        size_t hash = hash_of(text);
+        CInternEntry* fresh = nullptr;
+        for (Segment* segment = head_; ; segment = next_segment(segment)) {
+            for (size_t probe = 0; probe < kProbeWindow; ++probe) {
+                std::atomic<CInternEntry*>& slot = segment->slots[(hash + probe) & (segment->capacity - 1)];
+                CInternEntry* entry = slot.load(std::memory_order_acquire);
+                if (!entry) {
+                    if (!fresh) fresh = make_entry(text, hash);
+                    if (slot.compare_exchange_strong(entry, fresh, std::memory_order_acq_rel,
+                                                     std::memory_order_acquire)) {
+                        count_.fetch_add(1, std::memory_order_relaxed);
+                        return fresh;
+                    }
+                    // Lost the race: entry now holds the winner; fall through and compare.
+                }
+                if (entry->hash == hash && entry->view() == text) {
+                    ::operator delete(fresh);
+                    return entry;
+                }
+            }
+        }
+    }
+
+    // Returns the entry for text if it has been interned, nullptr otherwise.
+    const CInternEntry* find(std::string_view text) const {
+        size_t hash = hash_of(text);
+        for (Segment* segment = head_; segment; segment = segment->next.load(std::memory_order_acquire)) {
+            for (size_t probe = 0; probe < kProbeWindow; ++probe) {
+                CInternEntry* entry = segment->slots[(hash + probe) & (segment->capacity - 1)]
+                                          .load(std::memory_order_acquire);
+                if (!entry) return nullptr;
+                if (entry->hash == hash && entry->view() == text) return entry;
+            }
+        }
+        return nullptr;
+    }
+
+    size_t size() const { return count_.load(std::memory_order_relaxed); }
+
+    // Process-wide table used by CIString; never destroyed, so handles stay
+    // valid during static destruction.
+    static CInternTable& global() {
+        static CInternTable* table = new CInternTable();
+        return *table;
+    }
+
+private:
+    static constexpr size_t kProbeWindow = 32;
+
+    struct Segment {
+        explicit Segment(size_t capacity) : capacity(capacity), slots(new std::atomic<CInternEntry*>[capacity]) {
+            for (size_t i = 0; i < capacity; ++i) slots[i].store(nullptr, std::memory_order_relaxed);
+        }
+        ~Segment() { delete[] slots; }
+
+        const size_t capacity;
+        std::atomic<CInternEntry*>* slots;
+        std::atomic<Segment*> next{nullptr};
+    };
+
+    static size_t round_up_pow2(size_t n) {
+        size_t size = 64;
+        while (size < n) size <<= 1;
+        return size;
+    }
+
+    // FNV-1a; stored in the entry so handles hash in O(1).
+    static size_t hash_of(std::string_view text) {
+        uint64_t hash = 14695981039346656037ULL;
+        for (unsigned char c : text) {
+            hash ^= c;
+            hash *= 1099511628211ULL;
+        }
+        return static_cast<size_t>(hash ^ (hash >> 32));
+    }
+
+    static CInternEntry* make_entry(std::string_view text, size_t hash) {
+        void* memory = ::operator new(offsetof(CInternEntry, data) + text.size() + 1);
+        CInternEntry* entry = static_cast<CInternEntry*>(memory);
+        entry->hash = hash;
+        entry->size = static_cast<uint32_t>(text.size());
+        std::memcpy(entry->data, text.data(), text.size());
+        entry->data[text.size()] = '\0';
+        return entry;
+    }
+
+    Segment* next_segment(Segment* segment) {
+        Segment* next = segment->next.load(std::memory_order_acquire);
+        if (next) return next;
+        Segment* grown = new Segment(segment->capacity * 2);
+        if (segment->next.compare_exchange_strong(next, grown, std::memory_order_acq_rel,
+                                                  std::memory_order_acquire)) {
+            return grown;
+        }
+        delete grown;
+        return next;
+    }
+
+    Segment* const head_;
+    std::atomic<size_t> count_{0};
+};
+
+class CIString {
+public:
+    CIString() = default;
+    CIString(std::string_view text) : entry_(CInternTable::global().intern(text)) {}
+    CIString(const char* text) : CIString(std::string_view(text)) {}
+    CIString(const std::string& text) : CIString(std::string_view(text)) {}
+    CIString(CInternTable& table, std::string_view text) : entry_(table.intern(text)) {}
+
+    const char* c_str() const { return entry_ ? entry_->data : ""; }
+    std::string_view view() const { return entry_ ? entry_->view() : std::string_view(); }
+    std::string str() const { return std::string(view()); }
+    size_t size() const { return entry_ ? entry_->size : 0; }
+    bool empty() const { return size() == 0; }
+    size_t hash() const { return entry_ ? entry_->hash : 0; }
+
+    // Identity comparison: equal text from the same table means the same entry.
+    bool operator==(const CIString& other) const { return entry_ == other.entry_; }
+    bool operator!=(const CIString& other) const { return entry_ != other.entry_; }
+    // Orders by entry address (fast, stable for the process), not alphabetically.
+    bool operator<(const CIString& other) const { return std::less<const CInternEntry*>()(entry_, other.entry_); }
+
+private:
+    const CInternEntry* entry_ = nullptr;
+};
+
+inline std::ostream& operator<<(std::ostream& os, const CIString& s) {
+    return os << s.view();
+}
+
+namespace std {
+template <>
+struct hash<CIString> {
+    size_t operator()(const CIString& s) const noexcept { return s.hash(); }
+};
+}
+
+// usage example
+/*
+CGlobalEvent<CIString> m_onStatusToGuiUpdate;   // payload is one pointer
+
+m_onStatusToGuiUpdate.subscribe([](CIString info) {
+    static const CIString kDev7Down("Dev_7 Down");
+    if (info == kDev7Down) alarm();            // pointer compare
+    std::cout << info << std::endl;
+});
+
+// the first "Dev_7 Ok" allocates once; every later trigger is allocation-free
+m_onStatusToGuiUpdate.trigger(CIString(acLog));
+*/
+
+#endif
@@ -0,0 +1,364 @@
+/**************************************************************
+
+DESCRIPTION
+
+	This file defines CLogSink, an asynchronous log sink with
+	deferred formatting, built on the event templates.
+
+	On the calling thread, log() only copies a pointer to the static
+	format string and the raw arguments into that thread's own SPSC
+	ring buffer. Strings are copied as bytes; nothing is formatted
+	or allocated. A background consumer drains the rings, formats
+	each record with snprintf and triggers formatted(), a
+	CEventSafe<int, std::string>, so the file log, the GUI and any
+	other subscriber are served off the hot thread.
+
+	A full ring drops the record and counts it instead of
+	blocking. Records from one thread stay in order; records from
+	different threads are not merged by time. A thread's ring is
+	retired when the thread exits and freed by the consumer once
+	it has been drained.
+
+**************************************************************/
+
+
+#ifndef __CLogSink_h__
+#define __CLogSink_h__
+
+#include "EventTemplate.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+// Wire format of one log argument. Strings are copied with their terminator
+// so the consumer can hand a const char* straight to snprintf.
+template <typename T, typename Enable = void>
+struct CLogArg {
+    static_assert(std::is_arithmetic<T>::value || std::is_enum<T>::value || std::is_pointer<T>::value,
+                  "log arguments must be numbers, pointers or strings");
+    using Decoded = T;
+    static size_t size(const T&) { return sizeof(T); }
+    static void write(char*& p, const T& value) { std::memcpy(p, &value, sizeof(T)); p += sizeof(T); }
+    static Decoded read(const char*& p) {
+        T value;
+        std::memcpy(&value, p, sizeof(T));
+        p += sizeof(T);
+        return value;
+    }
+};
+
+struct CLogStringArg {
+    using Decoded = const char*;
+    static size_t size_of(const char* s, size_t len) { (void)s; return sizeof(uint32_t) + len + 1; }
+    static void write_bytes(char*& p, const char* s, size_t len) {
+        uint32_t n = static_cast<uint32_t>(len);
+        std::memcpy(p, &n, sizeof(n));
+        std::memcpy(p + sizeof(n), s, len);
+        p[sizeof(n) + len] = '\0';
+        p += sizeof(n) + len + 1;
+    }
+    static Decoded read(const char*& p) {
+        uint32_t n;
+        std::memcpy(&n, p, sizeof(n));
+        const char* s = p + sizeof(n);
+        p += sizeof(n) + n + 1;
+        return s;
+    }
+};
+
+template <>
+struct CLogArg<const char*> : CLogStringArg {
+    static size_t size(const char* s) { return size_of(s, s ? std::strlen(s) : 0); }
+    static void write(char*& p, const char* s) { write_bytes(p, s ? s : "", s ? std::strlen(s) : 0); }
+};
+
+template <>
+struct CLogArg<char*> : CLogArg<const char*> {};
+
+template <>
+struct CLogArg<std::string> : CLogStringArg {
+    static size_t size(const std::string& s) { return size_of(s.data(), s.size()); }
+    static void write(char*& p, const std::string& s) { write_bytes(p, s.data(), s.size()); }
+};
+
+class CLogSink {
+public:
+    explicit CLogSink(size_t ring_bytes_per_thread = 64 * 1024)
+        : ringBytes_(round_up_pow2(ring_bytes_per_thread)),
+          sinkId_(next_sink_id()),
+          formatted_(std::make_shared<CEventSafe<int, std::string>>()) {
+        consumer_ = std::thread([this]() { consume(); });
+    }
+
+    // Formats and delivers everything still queued.
+    ~CLogSink() {
+        stopping_.store(true, std::memory_order_release);
+        consumer_.join();
+    }
+
+    CLogSink(const CLogSink&) = delete;
+    CLogSink& operator=(const CLogSink&) = delete;
+
+    // fmt must be a string with static storage (a literal); it is formatted later.
+    // With no arguments it is delivered verbatim, not as a format.
+    template <typename... A>
+    bool log(int category, const char* fmt, const A&... args) {
+        Ring* ring = local_ring();
+        size_t need = align(sizeof(Header) + (size_t(0) + ... + CLogArg<std::decay_t<A>>::size(args)));
+        char* p = ring->reserve(need);
+        if (!p) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        Header header{static_cast<uint32_t>(need), category, &format_record<std::decay_t<A>...>, fmt};
+        std::memcpy(p, &header, sizeof(header));
+        [[maybe_unused]] char* q = p + sizeof(header);
+        (CLogArg<std::decay_t<A>>::write(q, args), ...);
+        ring->commit(need);
+        return true;
+    }
+
+    // Subscribe here to receive (category, text) on the consumer thread.
+    const std::shared_ptr<CEventSafe<int, std::string>>& formatted() const { return formatted_; }
+
+    // Blocks until every record logged before the call has been delivered.
+    void flush() {
+        uint64_t target = logged_snapshot();
+        while (delivered_.load(std::memory_order_acquire) < target) {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    }
+
+    unsigned long dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    using FormatFn = void (*)(const char* fmt, const char* args, std::string& out);
+
+    struct Header {
+        uint32_t size;      // whole record, padded; a null format fn marks ring padding
+        int category;
+        FormatFn format;
+        const char* fmt;
+    };
+
+    // Single-producer (owning thread) single-consumer byte ring.
+    class Ring {
+    public:
+        explicit Ring(size_t bytes) : buffer_(bytes), mask_(bytes - 1) {}
+
+        char* reserve(size_t need) {
+            uint64_t tail = tail_.load(std::memory_order_relaxed);
+            size_t offset = tail & mask_;
+            size_t contiguous = buffer_.size() - offset;
+            size_t wanted = need <= contiguous ? need : contiguous + need;
+            if (wanted > buffer_.size()) return nullptr;
+            if (tail + wanted - headCache_ > buffer_.size()) {
+                headCache_ = head_.load(std::memory_order_acquire);
+                if (tail + wanted - headCache_ > buffer_.size()) return nullptr;
+            }
+            if (need > contiguous) {
+                // Pad out the end of the buffer and start again at offset 0.
+                Header pad{static_cast<uint32_t>(contiguous), 0, nullptr, nullptr};
+                std::memcpy(&buffer_[offset], &pad, sizeof(pad));
+                tail_.store(tail + contiguous, std::memory_order_release);
+                offset = 0;
+            }
+            return &buffer_[offset];
+        }
+
+        void commit(size_t need) {
+            tail_.store(tail_.load(std::memory_order_relaxed) + need, std::memory_order_release);
+            logged_.fetch_add(1, std::memory_order_release);
+        }
+
+        // Consumer side: returns records delivered.
+        uint64_t drain(CEventSafe<int, std::string>& out, std::string& text) {
+            uint64_t count = 0;
+            uint64_t head = head_.load(std::memory_order_relaxed);
+            uint64_t tail = tail_.load(std::memory_order_acquire);
+            while (head != tail) {
+                Header header;
+                std::memcpy(&header, &buffer_[head & mask_], sizeof(header));
+                if (header.format) {
+                    header.format(header.fmt, &buffer_[(head & mask_) + sizeof(Header)], text);
+                    out.trigger(header.category, text);
+                    ++count;
+                }
+                head += header.size;
+                head_.store(head, std::memory_order_release);
+            }
+            return count;
+        }
+
+        uint64_t logged() const { return logged_.load(std::memory_order_acquire); }
+
+        // Producer side, at thread exit: no more records will be committed.
+        void retire() { dead_.store(true, std::memory_order_release); }
+
+        // Consumer side: retired and fully drained.
+        bool reclaimable() const {
+            return dead_.load(std::memory_order_acquire) &&
+                   head_.load(std::memory_order_relaxed) == tail_.load(std::memory_order_acquire);
+        }
+
+    private:
+        std::vector<char> buffer_;
+        size_t mask_;
+        std::atomic<uint64_t> head_{0};
+        std::atomic<uint64_t> tail_{0};
+        std::atomic<uint64_t> logged_{0};
+        std::atomic<bool> dead_{false};
+        uint64_t headCache_ = 0;   // producer's last view of head_
+    };
+
+    // A thread's rings, one per sink it logged to; retired when the thread exits.
+    struct ThreadRings {
+        std::vector<std::pair<uint64_t, std::shared_ptr<Ring>>> rings;
+
+        ~ThreadRings() {
+            for (auto& entry : rings) entry.second->retire();
+        }
+    };
+
+    template <typename... A>
+    static void format_record(const char* fmt, [[maybe_unused]] const char* args, std::string& out) {
+        if constexpr (sizeof...(A) == 0) {
+            out.assign(fmt);
+        } else {
+            // Braced init keeps the reads in argument order.
+            std::tuple<typename CLogArg<A>::Decoded...> values{CLogArg<A>::read(args)...};
+            std::apply([&](auto... v) {
+                int len = std::snprintf(nullptr, 0, fmt, v...);
+                out.resize(len > 0 ? static_cast<size_t>(len) : 0);
+                if (len > 0) std::snprintf(&out[0], out.size() + 1, fmt, v...);
+            }, values);
+        }
+    }
+
+    // Records are multiples of 32 bytes, so the gap left at the end of the
+    // ring always has room for a padding header.
+    static constexpr size_t kRecordAlign = 32;
+    static_assert(sizeof(Header) <= kRecordAlign, "header must fit the padding slot");
+
+    static size_t align(size_t n) { return (n + kRecordAlign - 1) & ~(kRecordAlign - 1); }
+
+    static size_t round_up_pow2(size_t n) {
+        size_t size = 1024;
+        while (size < n) size <<= 1;
+        return size;
+    }
+
+    static uint64_t next_sink_id() {
+        static std::atomic<uint64_t> id{1};
+        return id.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Each thread caches its ring per sink; the id (not the address) identifies
+    // the sink so a stale entry can never match a newer sink. Rings are shared
+    // with the sink so either side may go first.
+    Ring* local_ring() {
+        thread_local ThreadRings cache;
+        for (auto& entry : cache.rings) {
+            if (entry.first == sinkId_) return entry.second.get();
+        }
+        // Drop rings whose sink is gone.
+        cache.rings.erase(std::remove_if(cache.rings.begin(), cache.rings.end(),
+                              [](const auto& entry) { return entry.second.use_count() == 1; }),
+                          cache.rings.end());
+        auto ring = std::make_shared<Ring>(ringBytes_);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            rings_.push_back(ring);
+        }
+        cache.rings.emplace_back(sinkId_, ring);
+        return ring.get();
+    }
+
+    uint64_t logged_snapshot() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        uint64_t total = retiredLogged_;
+        for (auto& ring : rings_) total += ring->logged();
+        return total;
+    }
+
+    // Frees the rings of exited threads once drained, keeping their counts.
+    void reclaim() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        rings_.erase(std::remove_if(rings_.begin(), rings_.end(),
+                         [this](const std::shared_ptr<Ring>& ring) {
+                             if (!ring->reclaimable()) return false;
+                             retiredLogged_ += ring->logged();
+                             return true;
+                         }),
+                     rings_.end());
+    }
+
+    void consume() {
+        std::string text;
+        std::vector<Ring*> rings;
+        for (;;) {
+            bool stopping = stopping_.load(std::memory_order_acquire);
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                rings.clear();
+                for (auto& ring : rings_) rings.push_back(ring.get());
+            }
+            uint64_t count = 0;
+            for (Ring* ring : rings) count += ring->drain(*formatted_, text);
+            delivered_.fetch_add(count, std::memory_order_release);
+            reclaim();
+            if (count == 0) {
+                if (stopping) return;
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+            }
+        }
+    }
+
+    const size_t ringBytes_;
+    const uint64_t sinkId_;
+    std::shared_ptr<CEventSafe<int, std::string>> formatted_;
+    std::mutex mutex_;                          // guards rings_ and retiredLogged_
+    std::vector<std::shared_ptr<Ring>> rings_;
+    uint64_t retiredLogged_ = 0;                // records logged to freed rings
+    std::atomic<bool> stopping_{false};
+    std::atomic<uint64_t> delivered_{0};
+    std::atomic<unsigned long> dropped_{0};
+    std::thread consumer_;
+};
+
+// usage example
+/*
+CLogSink g_logSink;
+
+// consumer side: file log and GUI fan-out, off the device thread
+auto fileSub = g_logSink.formatted()->subscribe([](int category, std::string text) {
+    g_pLog->LogInfo(category, text.c_str());
+});
+auto guiSub = g_logSink.formatted()->subscribe([](int, std::string text) {
+    g_pDevStatus->m_onStatusToGuiUpdate.trigger(text);
+});
+
+void CEventDev::SetState(int nState)
+{
+    if (m_nState == nState) {
+        return;
+    }
+    m_nState = nState;
+
+    // no snprintf, no std::string on the device thread
+    g_logSink.log(LOG_SYS, nState == DEV_STATE_OK ? "%s_%d Ok" : "%s_%d Down", m_acName, m_nId);
+}
+*/
+
+#endif
@@ -0,0 +1,243 @@
+/**************************************************************
+
+DESCRIPTION
+
+	This file defines CPrometheusExporter, which periodically
+	writes the event statistics of a CEventStatsRegion as a
+	Prometheus text file for the node-exporter textfile collector.
+
+	Each round reads every live slot (summing the per-thread
+	shards with relaxed loads, so triggering threads never wait)
+	and renders:
+
+	  <prefix>_triggers_total, _handler_calls_total, _drops_total
+	  <prefix>_subscribers, _queue_depth                 (gauges)
+	  <prefix>_handler_duration_seconds                  (histogram)
+	  <prefix>_timer_lateness_seconds                    (histogram,
+	                                                      timer slots)
+
+	labelled by slot name, kind and index (slots may share a
+	name). Rates are left to PromQL
+	(rate(..._triggers_total[1m])). The file is written to a
+	temporary name and renamed, so the collector never reads a
+	half-written file.
+
+**************************************************************/
+
+
+#ifndef __CPrometheusExporter_h__
+#define __CPrometheusExporter_h__
+
+#include "CEventStats.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+class CPrometheusExporter {
+public:
+    // path should end in .prom and sit in the collector's textfile directory.
+    CPrometheusExporter(std::shared_ptr<CEventStatsRegion> region, std::string path,
+                        std::chrono::milliseconds interval = std::chrono::milliseconds(15000),
+                        std::string prefix = "event")
+        : region_(std::move(region)), path_(std::move(path)), interval_(interval), prefix_(std::move(prefix)) {
+        thread_ = std::thread([this]() { run(); });
+    }
+
+    // Writes one final file, then stops.
+    ~CPrometheusExporter() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        cv_.notify_all();
+        thread_.join();
+    }
+
+    CPrometheusExporter(const CPrometheusExporter&) = delete;
+    CPrometheusExporter& operator=(const CPrometheusExporter&) = delete;
+
+    // Renders and writes the file now; false if it could not be written.
+    // Callers are serialized, as they share the temporary file.
+    bool write_now() {
+        std::lock_guard<std::mutex> lock(writeMutex_);
+        std::string text = render();
+        std::string tmp = path_ + ".tmp." + std::to_string(::getpid());
+        FILE* file = std::fopen(tmp.c_str(), "w");
+        if (!file) return fail();
+        bool ok = std::fwrite(text.data(), 1, text.size(), file) == text.size();
+        ok = std::fflush(file) == 0 && ok;
+        ok = std::fclose(file) == 0 && ok;
+        if (!ok || std::rename(tmp.c_str(), path_.c_str()) != 0) {
+            std::remove(tmp.c_str());
+            return fail();
+        }
+        writes_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Exposition-format text for the current state of the region.
+    std::string render() const {
+        // One read per slot, so every metric of a slot comes from the same instant.
+        std::vector<Row> slots;
+        for (uint32_t i = 0; i < region_->slot_count(); ++i) {
+            const CEventStatsSlot& slot = region_->slot(i);
+            if (slot.live()) slots.push_back(Row{slot.read(), i});
+        }
+        std::string out;
+        out.reserve(4096);
+        header(out, "triggers_total", "counter", "Triggers (posts for dispatchers) since the slot was allocated.");
+        for_each(slots, [&](const Row& s) { sample(out, "triggers_total", s, "", std::to_string(s.triggers)); });
+        header(out, "handler_calls_total", "counter", "Handler invocations.");
+        for_each(slots, [&](const Row& s) { sample(out, "handler_calls_total", s, "", std::to_string(s.calls)); });
+        header(out, "drops_total", "counter", "Events shed or dropped instead of delivered.");
+        for_each(slots, [&](const Row& s) { sample(out, "drops_total", s, "", std::to_string(s.drops)); });
+        header(out, "subscribers", "gauge", "Current subscriber count.");
+        for_each(slots, [&](const Row& s) { sample(out, "subscribers", s, "", std::to_string(s.subscribers)); });
+        header(out, "queue_depth", "gauge", "Items waiting in an async queue.");
+        for_each(slots, [&](const Row& s) {
+            if (s.kind == EStatsKind::Dispatcher) sample(out, "queue_depth", s, "", std::to_string(s.queue_depth));
+        });
+        header(out, "handler_duration_seconds", "histogram", "Time spent in handlers.");
+        for_each(slots, [&](const Row& s) {
+            if (s.kind != EStatsKind::Timer) histogram(out, "handler_duration_seconds", s);
+        });
+        header(out, "timer_lateness_seconds", "histogram", "Delay between a timed callback's deadline and its start.");
+        for_each(slots, [&](const Row& s) {
+            if (s.kind == EStatsKind::Timer) histogram(out, "timer_lateness_seconds", s);
+        });
+        return out;
+    }
+
+    unsigned long writes() const { return writes_.load(std::memory_order_relaxed); }
+    unsigned long failures() const { return failures_.load(std::memory_order_relaxed); }
+
+private:
+    struct Row : CEventStatsSnapshot {
+        uint32_t slot;
+    };
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!stopping_) {
+            lock.unlock();
+            write_now();
+            lock.lock();
+            cv_.wait_for(lock, interval_, [this]() { return stopping_; });
+        }
+        lock.unlock();
+        write_now();
+    }
+
+    bool fail() {
+        failures_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    template <typename Fn>
+    static void for_each(const std::vector<Row>& slots, Fn fn) {
+        for (const auto& snap : slots) fn(snap);
+    }
+
+    static const char* kind_label(EStatsKind kind) {
+        switch (kind) {
+        case EStatsKind::Dispatcher: return "dispatcher";
+        case EStatsKind::Subscriber: return "subscriber";
+        case EStatsKind::Timer: return "timer";
+        default: return "event";
+        }
+    }
+
+    static void escape(std::string& out, const char* value) {
+        for (const char* p = value; *p; ++p) {
+            if (*p == '\\' || *p == '"') out += '\\';
+            if (*p == '\n') {
+                out += "\\n";
+                continue;
+            }
+            out += *p;
+        }
+    }
+
+    void header(std::string& out, const char* metric, const char* type, const char* help) const {
+        out += "# HELP " + prefix_ + "_" + metric + " " + help + "\n";
+        out += "# TYPE " + prefix_ + "_" + metric + " " + type + "\n";
+    }
+
+    // metric{name="...",kind="...",slot="..."<extra>} value
+    void sample(std::string& out, const std::string& metric, const Row& s,
+                const std::string& extra, const std::string& value) const {
+        out += prefix_;
+        out += '_';
+        out += metric;
+        out += "{name=\"";
+        escape(out, s.name);
+        out += "\",kind=\"";
+        out += kind_label(s.kind);
+        out += "\",slot=\"";
+        out += std::to_string(s.slot);
+        out += '"';
+        out += extra;
+        out += "} ";
+        out += value;
+        out += '\n';
+    }
+
+    // Buckets are the log2 nanosecond buckets of the slot, made cumulative.
+    void histogram(std::string& out, const std::string& metric, const Row& s) const {
+        uint64_t cumulative = 0;
+        char le[48];
+        for (size_t b = 0; b + 1 < CEventStatsSnapshot::kLatencyBuckets; ++b) {
+            cumulative += s.latency[b];
+            std::snprintf(le, sizeof(le), ",le=\"%.9g\"", static_cast<double>(uint64_t(2) << b) * 1e-9);
+            sample(out, metric + "_bucket", s, le, std::to_string(cumulative));
+        }
+        cumulative += s.latency[CEventStatsSnapshot::kLatencyBuckets - 1];   // open-ended last bucket
+        sample(out, metric + "_bucket", s, ",le=\"+Inf\"", std::to_string(cumulative));
+        char sum[32];
+        std::snprintf(sum, sizeof(sum), "%.9g", static_cast<double>(s.latency_sum_ns) * 1e-9);
+        sample(out, metric + "_sum", s, "", sum);
+        sample(out, metric + "_count", s, "", std::to_string(cumulative));
+    }
+
+    std::shared_ptr<CEventStatsRegion> region_;
+    const std::string path_;
+    const std::chrono::milliseconds interval_;
+    const std::string prefix_;
+
+    std::mutex writeMutex_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stopping_ = false;
+    std::atomic<unsigned long> writes_{0};
+    std::atomic<unsigned long> failures_{0};
+    std::thread thread_;
+};
+
+// usage example
+/*
+auto g_stats = CEventStatsRegion::create("/devmon_events");
+
+auto onStatus = std::make_shared<CEventSafe<std::string>>();
+onStatus->set_stats(g_stats->allocate("onStatus"));
+
+CTimedEvent<int> onRetry;
+onRetry.set_stats(g_stats->allocate("onRetry", EStatsKind::Timer));
+
+CAsyncDispatcher guiQueue(1);
+guiQueue.set_stats(g_stats->allocate("guiQueue", EStatsKind::Dispatcher));
+
+// node_exporter --collector.textfile.directory=/var/lib/node_exporter
+CPrometheusExporter exporter(g_stats, "/var/lib/node_exporter/devmon_events.prom",
+                             std::chrono::seconds(15), "devmon_event");
+*/
+
+#endif
@@ -0,0 +1,226 @@
+/**************************************************************
+
+DESCRIPTION
+
+	This file defines per-subscriber rate limiting for the event
+	templates.
+
+	CTokenBucket is a lock-free token bucket kept as a single
+	atomic "theoretical arrival time" (GCRA), so admitting an
+	event is one load and one CAS. CRateLimiter wraps a callback
+	with a bucket; subscribe its callback() to any event. Events
+	over the limit are dropped, conflated (only the latest is kept
+	and delivered when the next token frees up) or deferred until
+	their token is due. Conflated and deferred deliveries run on
+	the ITimerScheduler from CTimedEvent.h, and the bucket reads
+	that scheduler's clock, so a CVirtualTimerScheduler drives
+	both deterministically.
+
+	On the default CThreadTimerScheduler every deferred event is a
+	sleeping thread until its token is due, so keep max_deferred
+	small there or give Defer limiters a queue-based scheduler.
+
+**************************************************************/
+
+
+#ifndef __CRateLimit_h__
+#define __CRateLimit_h__
+
+#include "CTimedEvent.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <tuple>
+
+class CTokenBucket {
+public:
+    // rate tokens per second, holding at most burst tokens.
+    CTokenBucket(double rate, unsigned int burst)
+        : interval_(static_cast<int64_t>(1e9 / std::max(rate, 1e-9))),
+          tolerance_(interval_ * static_cast<int64_t>(std::max(burst, 1u) - 1)) {}
+
+    static int64_t now_ns() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // Takes a token if one is available at now.
+    bool try_acquire(int64_t now = now_ns()) {
+        int64_t tat = tat_.load(std::memory_order_relaxed);
+        for (;;) {
+            int64_t base = std::max(tat, now);
+            if (base - now > tolerance_) return false;
+            if (tat_.compare_exchange_weak(tat, base + interval_, std::memory_order_relaxed)) return true;
+        }
+    }
+
+    // Takes the next token even if it is in the future; returns ns until it is due.
+    int64_t reserve(int64_t now = now_ns()) {
+        int64_t tat = tat_.load(std::memory_order_relaxed);
+        for (;;) {
+            int64_t base = std::max(tat, now);
+            if (tat_.compare_exchange_weak(tat, base + interval_, std::memory_order_relaxed)) {
+                return std::max<int64_t>(0, base - tolerance_ - now);
+            }
+        }
+    }
+
+private:
+    const int64_t interval_;    // ns per token
+    const int64_t tolerance_;   // how far tat may run ahead of now (burst - 1 tokens)
+    std::atomic<int64_t> tat_{0};
+};
+
+enum class ERateLimitMode {
+    Drop,       // discard excess events
+    Conflate,   // keep only the latest excess event, deliver it when a token frees up
+    Defer       // deliver every event once its token is due (up to max_deferred pending)
+};
+
+struct CRateLimit {
+    double events_per_second;
+    unsigned int burst = 1;
+    ERateLimitMode mode = ERateLimitMode::Drop;
+    unsigned int max_deferred = 64;     // Defer: beyond this, events are dropped (each pending
+                                        // one is a thread on CThreadTimerScheduler)
+};
+
+template <typename... Args>
+class CRateLimiter : public std::enable_shared_from_this<CRateLimiter<Args...>> {
+public:
+    using Callback = std::function<void(Args...)>;
+
+    CRateLimiter(Callback callback, const CRateLimit& limit,
+                 std::shared_ptr<ITimerScheduler> scheduler = CThreadTimerScheduler::instance())
+        : callback_(std::move(callback)), limit_(limit),
+          bucket_(limit.events_per_second, limit.burst), scheduler_(std::move(scheduler)) {}
+
+    // Callback to subscribe with; it keeps the limiter alive.
+    Callback callback() {
+        auto self = this->shared_from_this();
+        return [self](Args... args) { self->invoke(args...); };
+    }
+
+    void invoke(Args... args) {
+        if (bucket_.try_acquire(now())) {
+            delivered_.fetch_add(1, std::memory_order_relaxed);
+            callback_(args...);
+            return;
+        }
+        switch (limit_.mode) {
+        case ERateLimitMode::Drop:
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            break;
+        case ERateLimitMode::Conflate:
+            conflate(args...);
+            break;
+        case ERateLimitMode::Defer:
+            defer(args...);
+            break;
+        }
+    }
+
+    unsigned long delivered() const { return delivered_.load(std::memory_order_relaxed); }
+    unsigned long dropped() const { return dropped_.load(std::memory_order_relaxed); }
+    unsigned long conflated() const { return conflated_.load(std::memory_order_relaxed); }
+    unsigned long deferred() const { return deferredTotal_.load(std::memory_order_relaxed); }
+
+private:
+    using Stored = std::tuple<std::decay_t<Args>...>;
+
+    int64_t now() const { return static_cast<int64_t>(scheduler_->now_ns()); }
+
+    static unsigned int to_ms(int64_t ns) {
+        return static_cast<unsigned int>((ns + 999999) / 1000000);
+    }
+
+    void conflate(Args... args) {
+        int64_t wait = -1;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (latest_) conflated_.fetch_add(1, std::memory_order_relaxed);  // replaces an older one
+            latest_.emplace(args...);
+            if (!flushScheduled_) {
+                flushScheduled_ = true;
+                wait = bucket_.reserve(now());
+            }
+        }
+        if (wait < 0) return;
+
+        auto self = this->shared_from_this();
+        scheduler_->schedule(to_ms(wait), [self]() {
+            std::optional<Stored> latest;
+            {
+                std::lock_guard<std::mutex> lock(self->mutex_);
+                latest.swap(self->latest_);
+                self->flushScheduled_ = false;
+            }
+            if (latest) {
+                self->delivered_.fetch_add(1, std::memory_order_relaxed);
+                std::apply(self->callback_, *latest);
+            }
+        });
+        scheduler_->flush();
+    }
+
+    void defer(Args... args) {
+        if (deferredPending_.fetch_add(1, std::memory_order_relaxed) >= limit_.max_deferred) {
+            deferredPending_.fetch_sub(1, std::memory_order_relaxed);
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        deferredTotal_.fetch_add(1, std::memory_order_relaxed);
+        int64_t wait = bucket_.reserve(now());
+        auto self = this->shared_from_this();
+        scheduler_->schedule(to_ms(wait), [self, stored = Stored(args...)]() {
+            self->deferredPending_.fetch_sub(1, std::memory_order_relaxed);
+            self->delivered_.fetch_add(1, std::memory_order_relaxed);
+            std::apply(self->callback_, stored);
+        });
+        scheduler_->flush();
+    }
+
+    Callback callback_;
+    CRateLimit limit_;
+    CTokenBucket bucket_;
+    std::shared_ptr<ITimerScheduler> scheduler_;
+
+    std::mutex mutex_;                  // conflation slot only; never taken on the admitted path
+    std::optional<Stored> latest_;
+    bool flushScheduled_ = false;
+
+    std::atomic<unsigned int> deferredPending_{0};
+    std::atomic<unsigned long> delivered_{0};
+    std::atomic<unsigned long> dropped_{0};
+    std::atomic<unsigned long> conflated_{0};
+    std::atomic<unsigned long> deferredTotal_{0};
+};
+
+// Shorthand: event->subscribe(rate_limited<std::string>(cb, {10, 5, ERateLimitMode::Conflate}));
+template <typename... Args>
+std::function<void(Args...)> rate_limited(typename CRateLimiter<Args...>::Callback callback, const CRateLimit& limit,
+        std::shared_ptr<ITimerScheduler> scheduler = CThreadTimerScheduler::instance()) {
+    return std::make_shared<CRateLimiter<Args...>>(std::move(callback), limit, std::move(scheduler))->callback();
+}
+
+// usage example
+/*
+auto onStatus = std::make_shared<CEventSafe<std::string>>();
+
+// GUI redraws at most 10 times a second and only cares about the newest text
+auto guiLimiter = std::make_shared<CRateLimiter<std::string>>(
+    [](std::string info) { gui.show(info); },
+    CRateLimit{10, 1, ERateLimitMode::Conflate});
+auto guiSub = onStatus->subscribe(guiLimiter->callback());
+
+// remote notifier: 100/s with bursts of 20, excess dropped
+auto remoteSub = onStatus->subscribe(rate_limited<std::string>(
+    [](std::string info) { notifier.send(info); }, CRateLimit{100, 20}));
+*/
+
+#endif
@@ -0,0 +1,272 @@
+/**************************************************************
+
+DESCRIPTION
+
+	This file defines CShardedBus, a thread-per-core event bus for
+	shared-nothing services.
+
+	Every core (shard) owns a plain CEvent and its subscribers. A
+	trigger on a core stays on that core: it is an ordinary
+	CEvent::trigger() with no atomics and no locks. To reach
+	another core, send() pushes the arguments into the SPSC ring
+	of that (from, to) core pair. The target core's loop polls its
+	inbound rings and triggers its own CEvent. Each ring has one
+	writer and one reader; its head and tail sit on separate cache
+	lines, and each side caches the other's index, so a core only
+	touches a shared line when its cached view runs out.
+
+	start() runs one loop thread per core, pinned to a CPU when
+	the platform allows it. A service with its own reactor can
+	skip start() and call poll() from its loops instead. Either
+	way, subscribe(), trigger() and poll() for a core, and send()
+	from it, must run on that core's thread.
+
+	A full ring rejects the send and counts a drop rather than
+	blocking the sender.
+
+**************************************************************/
+
+
+#ifndef __CShardedBus_h__
+#define __CShardedBus_h__
+
+#include "EventTemplate.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+struct CShardedBusConfig {
+    size_t cores = std::max(1u, std::thread::hardware_concurrency());
+    size_t ring_capacity = 1024;                // per core pair, rounded up to a power of two
+    bool pin_threads = true;                    // start(): core i runs on the i-th allowed CPU
+    std::chrono::microseconds idle_sleep{50};   // start(): pause of an idle loop; 0 only yields
+};
+
+template <typename... Args>
+class CShardedBus {
+public:
+    using Callback = typename CEvent<Args...>::Callback;
+    using Handler = typename CEvent<Args...>::Handler;
+    using Subscription = typename CEvent<Args...>::Subscription;
+
+    explicit CShardedBus(CShardedBusConfig config = CShardedBusConfig()) : config_(config) {
+        if (config_.cores == 0) config_.cores = 1;
+        size_t capacity = 2;
+        while (capacity < config_.ring_capacity) capacity <<= 1;
+        shards_.reserve(config_.cores);
+        for (size_t core = 0; core < config_.cores; ++core) {
+            auto shard = std::make_unique<Shard>();
+            shard->event = std::make_shared<CEvent<Args...>>();
+            shard->inbound.resize(config_.cores);
+            for (size_t from = 0; from < config_.cores; ++from) {
+                if (from != core) shard->inbound[from] = std::make_unique<Ring>(capacity);
+            }
+            shards_.push_back(std::move(shard));
+        }
+    }
+
+    ~CShardedBus() { stop(); }
+
+    CShardedBus(const CShardedBus&) = delete;
+    CShardedBus& operator=(const CShardedBus&) = delete;
+
+    size_t cores() const { return shards_.size(); }
+
+    // On core's thread, or before start().
+    Subscription subscribe(size_t core, Callback callback) {
+        return shards_[core]->event->subscribe(std::move(callback));
+    }
+
+    Subscription subscribe_handler(size_t core, Handler handler) {
+        return shards_[core]->event->subscribe_handler(std::move(handler));
+    }
+
+    // Core-local delivery.
+    void trigger(size_t core, Args... args) { shards_[core]->event->trigger(args...); }
+
+    // Queues the trigger for core to; sending to the own core triggers at once.
+    // False (and a drop on from) if the (from, to) ring is full.
+    bool send(size_t from, size_t to, Args... args) {
+        if (from == to) {
+            trigger(from, args...);
+            return true;
+        }
+        if (shards_[to]->inbound[from]->push(args...)) return true;
+        Shard& shard = *shards_[from];
+        shard.dropped.store(shard.dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // Triggers on every core; returns the number of cores it reached.
+    size_t broadcast(size_t from, Args... args) {
+        size_t reached = 0;
+        for (size_t to = 0; to < shards_.size(); ++to) {
+            if (to != from && send(from, to, args...)) ++reached;
+        }
+        trigger(from, args...);
+        return reached + 1;
+    }
+
+    // Delivers up to max_per_ring queued triggers from each inbound ring of
+    // core; returns how many were delivered.
+    size_t poll(size_t core, size_t max_per_ring = SIZE_MAX) {
+        Shard& shard = *shards_[core];
+        CEvent<Args...>& event = *shard.event;
+        size_t delivered = 0;
+        for (auto& ring : shard.inbound) {
+            if (ring) delivered += ring->drain([&event](Args... args) { event.trigger(args...); }, max_per_ring);
+        }
+        return delivered;
+    }
+
+    // Runs one pinned loop per core. setup (optional) runs first on each
+    // core's thread, e.g. to subscribe core-local handlers.
+    void start(std::function<void(size_t core)> setup = nullptr) {
+        if (running_) return;
+        running_ = true;
+        for (size_t core = 0; core < shards_.size(); ++core) {
+            shards_[core]->stopping.store(false, std::memory_order_relaxed);
+            shards_[core]->thread = std::thread([this, core, setup]() {
+                if (config_.pin_threads) pin(core);
+                if (setup) setup(core);
+                run(core);
+            });
+        }
+    }
+
+    // Stops and joins the loops; each delivers what is already queued for it first.
+    void stop() {
+        if (!running_) return;
+        for (auto& shard : shards_) shard->stopping.store(true, std::memory_order_release);
+        for (auto& shard : shards_) shard->thread.join();
+        running_ = false;
+    }
+
+    // Sends from core that found the target ring full.
+    unsigned long dropped(size_t core) const { return shards_[core]->dropped.load(std::memory_order_relaxed); }
+
+private:
+    using Stored = std::tuple<std::decay_t<Args>...>;
+
+    // Single-producer single-consumer ring of stored triggers.
+    class Ring {
+    public:
+        explicit Ring(size_t capacity) : slots_(capacity), mask_(capacity - 1) {}
+
+        template <typename... A>
+        bool push(A&&... args) {
+            uint64_t tail = tail_.load(std::memory_order_relaxed);
+            if (tail - headCache_ > mask_) {
+                headCache_ = head_.load(std::memory_order_acquire);
+                if (tail - headCache_ > mask_) return false;
+            }
+            slots_[tail & mask_].emplace(std::forward<A>(args)...);
+            tail_.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        template <typename Fn>
+        size_t drain(Fn fn, size_t max) {
+            uint64_t head = head_.load(std::memory_order_relaxed);
+            if (head == tailCache_) {
+                tailCache_ = tail_.load(std::memory_order_acquire);
+                if (head == tailCache_) return 0;
+            }
+            size_t count = 0;
+            while (head != tailCache_ && count < max) {
+                std::optional<Stored>& slot = slots_[head & mask_];
+                Stored stored = std::move(*slot);
+                slot.reset();
+                head_.store(++head, std::memory_order_release);   // frees the slot before the handlers run
+                std::apply(fn, stored);
+                ++count;
+            }
+            return count;
+        }
+
+    private:
+        std::vector<std::optional<Stored>> slots_;
+        const uint64_t mask_;
+        alignas(64) std::atomic<uint64_t> head_{0};     // written by the consumer
+        uint64_t tailCache_ = 0;                        // consumer's last view of tail_
+        alignas(64) std::atomic<uint64_t> tail_{0};     // written by the producer
+        uint64_t headCache_ = 0;                        // producer's last view of head_
+    };
+
+    struct alignas(64) Shard {
+        std::shared_ptr<CEvent<Args...>> event;
+        std::vector<std::unique_ptr<Ring>> inbound;     // indexed by sending core; none from itself
+        std::atomic<unsigned long> dropped{0};          // written by this core only
+        std::atomic<bool> stopping{false};
+        std::thread thread;
+    };
+
+    void run(size_t core) {
+        std::atomic<bool>& stopping = shards_[core]->stopping;
+        for (;;) {
+            bool stop = stopping.load(std::memory_order_acquire);
+            if (poll(core) != 0) continue;
+            if (stop) return;
+            if (config_.idle_sleep.count() > 0) std::this_thread::sleep_for(config_.idle_sleep);
+            else std::this_thread::yield();
+        }
+    }
+
+    static void pin(size_t core) {
+#ifdef __linux__
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) return;
+        int count = CPU_COUNT(&allowed);
+        if (count <= 0) return;
+        int nth = static_cast<int>(core % static_cast<size_t>(count));
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (!CPU_ISSET(cpu, &allowed) || nth-- > 0) continue;
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpu, &set);
+            pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+            return;
+        }
+#else
+        (void)core;
+#endif
+    }
+
+    CShardedBusConfig config_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    bool running_ = false;
+};
+
+// usage example
+/*
+// one shard per core; each owns its devices and their subscribers
+CShardedBus<int, std::string> bus(CShardedBusConfig{4});
+
+bus.start([&bus](size_t core) {
+    static thread_local std::vector<CShardedBus<int, std::string>::Subscription> subs;
+    subs.push_back(bus.subscribe(core, [core](int devId, std::string info) {
+        g_devices[core].OnStatus(devId, info);     // no locks: only this core touches them
+    }));
+
+    // send() only from the sending core's thread: here core 1 hands a status
+    // change to the core owning device 42 (queued until that core polls)
+    if (core == 1) bus.send(1, 42 % bus.cores(), 42, "Down");
+});
+*/
+
+#endif
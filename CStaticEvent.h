@@ -0,0 +1,118 @@
+/**************************************************************
+
+DESCRIPTION
+
+	This file defines CStaticEvent, a global event whose
+	subscriber table is built by the compiler or the linker, so
+	nothing runs during static initialization.
+
+	CStaticEvent is a view over a constant array of plain function
+	pointers. The array can be written out by hand (constexpr,
+	explicit order), or collected by the linker:
+	STATIC_EVENT_SUBSCRIBE drops a function pointer into an ELF
+	section named after the event, and STATIC_EVENT_DECLARE reads
+	the section back through the __start_/__stop_ symbols the
+	linker emits. Subscribers can then live in any translation
+	unit without registration code or init-order worries.
+
+	The linker gives section entries no defined order, so handlers
+	collected that way must not depend on each other; use the
+	array form when they do. Sections need GCC/Clang on an ELF
+	target and do not mix with sanitizers that pad globals (ASan).
+
+**************************************************************/
+
+
+#ifndef __CStaticEvent_h__
+#define __CStaticEvent_h__
+
+#include <cstddef>
+#include <type_traits>
+
+template <typename... Args>
+class CStaticEvent {
+public:
+    using Handler = void (*)(Args...);
+
+    constexpr CStaticEvent() = default;
+    constexpr CStaticEvent(const Handler* begin, const Handler* end) : begin_(begin), end_(end) {}
+    template <size_t N>
+    constexpr CStaticEvent(const Handler (&handlers)[N]) : begin_(handlers), end_(handlers + N) {}
+
+    void trigger(Args... args) const {
+        for (const Handler* handler = begin_; handler != end_; ++handler) {
+            if (*handler) (*handler)(args...);
+        }
+    }
+
+    constexpr size_t size() const { return static_cast<size_t>(end_ - begin_); }
+    constexpr const Handler* begin() const { return begin_; }
+    constexpr const Handler* end() const { return end_; }
+
+private:
+    const Handler* begin_ = nullptr;
+    const Handler* end_ = nullptr;
+};
+
+#if defined(__GNUC__) && defined(__ELF__)
+
+#define STATIC_EVENT_SECTIONS 1
+
+#if defined(__has_attribute)
+#if __has_attribute(retain)
+#define STATIC_EVENT_RETAIN __attribute__((retain))   // survive --gc-sections
+#endif
+#endif
+#ifndef STATIC_EVENT_RETAIN
+#define STATIC_EVENT_RETAIN
+#endif
+
+#define STATIC_EVENT_CAT2(a, b) a##b
+#define STATIC_EVENT_CAT(a, b) STATIC_EVENT_CAT2(a, b)
+
+// Declares event `name` (usable as name().trigger(...)) with the given argument
+// types. Put it in a header seen by every subscriber and trigger site. The
+// bounds are weak so an event without subscribers links to an empty table.
+#define STATIC_EVENT_DECLARE(name, ...)                                                       \
+    extern "C" CStaticEvent<__VA_ARGS__>::Handler const __start_evt_##name[] __attribute__((weak)); \
+    extern "C" CStaticEvent<__VA_ARGS__>::Handler const __stop_evt_##name[] __attribute__((weak));  \
+    inline CStaticEvent<__VA_ARGS__> name() {                                                 \
+        return CStaticEvent<__VA_ARGS__>(__start_evt_##name, __stop_evt_##name);              \
+    }
+
+// Adds handler (a function or captureless lambda) to event `name` at namespace
+// scope. The entry is a constant in the event's section: no constructor runs.
+#define STATIC_EVENT_SUBSCRIBE(name, handler)                                                  \
+    static std::remove_const_t<std::remove_extent_t<decltype(__start_evt_##name)>> const        \
+        STATIC_EVENT_CAT(evt_entry_##name##_, __COUNTER__)                                     \
+        __attribute__((used, section("evt_" #name), aligned(sizeof(void*)))) STATIC_EVENT_RETAIN = handler
+
+#endif
+
+// usage example
+/*
+// --- compile-time table, explicit order (any compiler) ---
+void LogStatus(const char* info);
+void ShowStatus(const char* info);
+
+constexpr CStaticEvent<const char*>::Handler kStatusHandlers[] = { &LogStatus, &ShowStatus };
+constexpr CStaticEvent<const char*> g_onStatusToGuiUpdate(kStatusHandlers);
+
+g_onStatusToGuiUpdate.trigger(acLog);
+
+// --- link-time table (GCC/Clang, ELF) ---
+// DevEvents.h
+STATIC_EVENT_DECLARE(onDevStateChanged, int, int)    // (devId, state)
+
+// GuiPanel.cpp
+STATIC_EVENT_SUBSCRIBE(onDevStateChanged, [](int id, int state) { GuiPanel::Update(id, state); });
+
+// Alarm.cpp
+static void RaiseAlarm(int id, int state) { if (state != DEV_STATE_OK) Alarm::Raise(id); }
+STATIC_EVENT_SUBSCRIBE(onDevStateChanged, &RaiseAlarm);
+
+// CEventDev.cpp
+onDevStateChanged().trigger(m_nId, nState);
+*/
+
+#endif
@@ -0,0 +1,170 @@
+/**************************************************************
+
+DESCRIPTION
+
+	This file defines CThreadPool, a worker pool used by the
+	event templates to run subscribers off the triggering thread.
+
+	Tasks may carry a name (a string literal). With a CWatchdog
+	attached, each worker reports the task it is running. A task
+	that overruns the watchdog deadline gets a replacement
+	worker, and the stuck worker retires (and is detached) once
+	its task returns.
+
+	The pool sees the watchdog only through IPoolWatchdog, so it
+	does not pull in CWatchdog.h and its POSIX dependencies.
+
+**************************************************************/
+
+
+#ifndef __CThreadPool_h__
+#define __CThreadPool_h__
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// What a pool worker reports to a watchdog; CWatchdog implements it.
+class IPoolWatchdog {
+public:
+    class Worker {
+    public:
+        virtual ~Worker() = default;
+        // task must be a string literal.
+        virtual void begin(const char* task) = 0;
+        // True if the task was flagged hung and a replacement worker started.
+        virtual bool end() = 0;
+    };
+
+    virtual ~IPoolWatchdog() = default;
+
+    // compensate (optional) starts a replacement when this worker hangs.
+    virtual std::shared_ptr<Worker> attach_worker(const char* name, std::function<void()> compensate) = 0;
+    virtual void detach_worker(const std::shared_ptr<Worker>& worker) = 0;
+    // Called by a worker that retires after its compensated task returned.
+    virtual void compensation_done() = 0;
+};
+
+class CThreadPool {
+public:
+    using Task = std::function<void()>;
+
+    explicit CThreadPool(size_t threads = std::thread::hardware_concurrency(),
+                         std::shared_ptr<IPoolWatchdog> watchdog = nullptr)
+        : watchdog_(std::move(watchdog)) {
+        if (threads == 0) threads = 1;
+        workers_.reserve(threads);
+        for (size_t i = 0; i < threads; ++i) {
+            add_worker();
+        }
+    }
+
+    // Runs the tasks already queued, then joins the workers.
+    ~CThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        cv_.notify_all();
+        // Popped under the lock, as a retiring worker removes itself.
+        for (;;) {
+            std::thread worker;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (workers_.empty()) break;
+                worker = std::move(workers_.back());
+                workers_.pop_back();
+            }
+            worker.join();
+        }
+    }
+
+    CThreadPool(const CThreadPool&) = delete;
+    CThreadPool& operator=(const CThreadPool&) = delete;
+
+    // name, if given, must be a string literal; the watchdog reports it.
+    void submit(Task task, const char* name = nullptr) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            tasks_.push_back(Job{std::move(task), name});
+        }
+        cv_.notify_one();
+    }
+
+    // Starts one more worker; returns false once the pool is stopping.
+    bool add_worker() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_) return false;
+        ++active_;
+        workers_.emplace_back([this]() { work(); });
+        return true;
+    }
+
+    // Workers currently serving the queue.
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return active_;
+    }
+
+    size_t queued() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return tasks_.size();
+    }
+
+private:
+    struct Job {
+        Task task;
+        const char* name;
+    };
+
+    void work() {
+        std::shared_ptr<IPoolWatchdog::Worker> slot;
+        if (watchdog_) slot = watchdog_->attach_worker("pool worker", [this]() { add_worker(); });
+        bool retired = false;
+        for (;;) {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [this]() { return stopping_ || !tasks_.empty(); });
+                if (tasks_.empty()) break;
+                job = std::move(tasks_.front());
+                tasks_.pop_front();
+            }
+            if (slot) slot->begin(job.name);
+            job.task();
+            if (slot && slot->end()) {
+                // A replacement took over while this task hung; step aside.
+                watchdog_->compensation_done();
+                retired = true;
+                break;
+            }
+        }
+        if (slot) watchdog_->detach_worker(slot);
+        std::lock_guard<std::mutex> lock(mutex_);
+        --active_;
+        if (!retired) return;
+        // Nobody joins a retired worker, so it detaches itself; it touches the
+        // pool no more after this. Absent, the destructor is joining it already.
+        auto self = std::find_if(workers_.begin(), workers_.end(),
+            [](const std::thread& worker) { return worker.get_id() == std::this_thread::get_id(); });
+        if (self != workers_.end()) {
+            self->detach();
+            workers_.erase(self);
+        }
+    }
+
+    std::shared_ptr<IPoolWatchdog> watchdog_;
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<Job> tasks_;
+    bool stopping_ = false;
+    size_t active_ = 0;
+    std::vector<std::thread> workers_;      // changes under mutex_; grows never after stopping_
+};
+
+#endif
@@ -1,12 +1,24 @@
 
 // This code defines a C++ class `CTimedEvent` that allows you to subscribe to events with immediate or delayed callbacks.
+#ifndef __CTimedEvent_h__
+#define __CTimedEvent_h__
+
 #include <functional>
 #include <vector>
 #include <atomic>
 #include <thread>
 #include <mutex>
+#include <memory>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <cerrno>
+#include <type_traits>
+
+#include "CEventStatsOps.h"
 
-int delay(int nMs) {
+inline int delay(int nMs) {
     if (nMs < 0) return -1;
     struct timespec requested = {
         .tv_sec = static_cast<time_t>(nMs / 1000),
@@ -16,6 +28,42 @@ int delay(int nMs) {
     return 0;
 }
 
+// Backend that runs delayed callbacks. schedule() may only queue the timer;
+// flush() hands everything queued so far to the backend in one go, so a
+// trigger with many delayed subscribers costs a single submission.
+// now_ms() is the clock the deadlines are measured against; now_ns() is the
+// same clock at finer resolution, so a scheduler overriding one overrides both.
+class ITimerScheduler {
+public:
+    virtual ~ITimerScheduler() = default;
+    virtual void schedule(unsigned int delay_ms, std::function<void()> func) = 0;
+    virtual void flush() {}
+    virtual uint64_t now_ms() const {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+    virtual uint64_t now_ns() const {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+};
+
+// Portable scheduler: one detached thread per delayed callback.
+class CThreadTimerScheduler : public ITimerScheduler {
+public:
+    void schedule(unsigned int delay_ms, std::function<void()> func) override {
+        std::thread([func = std::move(func), delay_ms]() {
+            delay(delay_ms);  // Custom delay function
+            func();
+        }).detach();
+    }
+
+    static std::shared_ptr<ITimerScheduler> instance() {
+        static std::shared_ptr<ITimerScheduler> scheduler = std::make_shared<CThreadTimerScheduler>();
+        return scheduler;
+    }
+};
+
 template <typename... Args>
 class CTimedEvent {
 private:
@@ -26,6 +74,9 @@ private:
 
     std::vector<std::function<void(Args...)>> immediate_callbacks_;
     std::vector<TimedCallback> delayed_callbacks_;
+    std::shared_ptr<ITimerScheduler> scheduler_ = CThreadTimerScheduler::instance();
+    CEventStatsSlot* stats_ = nullptr;
+    const CEventStatsOps* statsOps_ = nullptr;
     std::mutex mutex_;
 
     // Helper to launch delayed callback
@@ -34,23 +85,61 @@ private:
                        Args... args) {
         // Bind the callback with its arguments
         auto bound_func = std::bind(callback, args...);
-        std::thread([bound_func, delay_ms]() {
-            delay(delay_ms);  // Custom delay function
-            bound_func();     // Invoke the bound function
-        }).detach();
+        if (!stats_) {
+            scheduler_->schedule(delay_ms, std::move(bound_func));
+            return;
+        }
+        // Lateness: how long after its deadline the callback actually started,
+        // both read from the clock the scheduler enforces the deadline with.
+        // The scheduler outlives the tasks it runs.
+        ITimerScheduler* clock = scheduler_.get();
+        uint64_t deadline = clock->now_ns() + uint64_t(delay_ms) * 1000000;
+        scheduler_->schedule(delay_ms, [stats = stats_, ops = statsOps_, clock, deadline,
+                                        bound_func = std::move(bound_func)]() {
+            uint64_t now = clock->now_ns();
+            ops->record_latency(stats, now > deadline ? now - deadline : 0);
+            bound_func();
+        });
     }
 
 public:
     using Callback = std::function<void(Args...)>;
 
+    // Replace the backend used for delayed callbacks (e.g. CUringTimerScheduler,
+    // or CVirtualTimerScheduler in tests).
+    void set_scheduler(std::shared_ptr<ITimerScheduler> scheduler) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        scheduler_ = scheduler ? std::move(scheduler) : CThreadTimerScheduler::instance();
+    }
+
+    // Counts triggers and records timer lateness of delayed callbacks in a
+    // shared-memory slot (EStatsKind::Timer, see CEventStats.h); nullptr detaches.
+    template <typename Slot>
+    void set_stats(Slot* stats) {
+        static_assert(std::is_same<Slot, CEventStatsSlot>::value, "set_stats() takes a CEventStatsSlot");
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stats) {
+            stats->set_subscribers(static_cast<int64_t>(immediate_callbacks_.size() + delayed_callbacks_.size()));
+            statsOps_ = CEventStatsOps::of<Slot>();
+        }
+        stats_ = stats;
+    }
+
+    void set_stats(std::nullptr_t) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_ = nullptr;
+    }
+
     void subscribe(Callback callback) {
         std::lock_guard<std::mutex> lock(mutex_);
         immediate_callbacks_.push_back(std::move(callback));
+        if (stats_) statsOps_->add_subscribers(stats_, 1);
     }
 
     void subscribe_with_delay(Callback callback, unsigned int delay_ms) {
         std::lock_guard<std::mutex> lock(mutex_);
         delayed_callbacks_.push_back({std::move(callback), delay_ms});
+        if (stats_) statsOps_->add_subscribers(stats_, 1);
     }
 
     void trigger(Args... args) {
@@ -58,12 +147,14 @@ public:
         // Process immediate callbacks
         {
             std::lock_guard<std::mutex> lock(mutex_);
+            if (stats_) statsOps_->count_trigger(stats_);
             for (const auto& cb : immediate_callbacks_) {
                 if (cb) cb(args...);
             }
         }
 
         // Process delayed callbacks
+        std::shared_ptr<ITimerScheduler> scheduler;
         {
             std::lock_guard<std::mutex> lock(mutex_);
             for (const auto& tcb : delayed_callbacks_) {
@@ -71,6 +162,10 @@ public:
                     launch_delayed(tcb.func, tcb.delay_ms, args...);
                 }
             }
+            scheduler = scheduler_;
         }
+        scheduler->flush();
     }
-};
\ No newline at end of file
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,378 @@
+/**************************************************************
+
+DESCRIPTION
+
+	This file defines CUringTimerScheduler, an io_uring backend
+	for CTimedEvent delayed callbacks and cross-thread wakeups.
+
+	Timers are written into the submission ring as IORING_OP_TIMEOUT
+	entries and only submitted on flush(), so one trigger with many
+	delayed subscribers costs one io_uring_enter(). A single completion
+	thread reaps the CQEs and runs the callbacks. post() wakes that
+	thread with IORING_OP_MSG_RING (IORING_OP_NOP on older kernels).
+
+	Use make_timer_scheduler() to fall back to the portable
+	CThreadTimerScheduler when io_uring is not available. If the
+	ring could not be set up, or stops accepting submissions later,
+	schedule() and post() hand their callbacks to
+	CThreadTimerScheduler instead. The destructor stops the
+	completion thread through an eventfd poll armed at setup, so
+	it does not depend on the submission ring still working.
+
+**************************************************************/
+
+
+#ifndef __CUringTimer_h__
+#define __CUringTimer_h__
+
+#include "CTimedEvent.h"
+
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <cstdlib>
+
+class CUringTimerScheduler : public ITimerScheduler {
+public:
+    explicit CUringTimerScheduler(unsigned int entries = 256) {
+        if (!setup(entries)) {
+            teardown();
+            return;
+        }
+        reaper_ = std::thread([this]() { reap_loop(); });
+    }
+
+    ~CUringTimerScheduler() override {
+        if (ring_fd_ < 0) return;
+        if (reaper_.get_id() == std::this_thread::get_id()) {
+            // Last owner let go inside a callback: the reaper cannot join
+            // itself, so it leaves the loop as soon as that callback returns.
+            *reaperExit_ = true;
+            reaper_.detach();
+        } else {
+            uint64_t one = 1;
+            while (write(stop_fd_, &one, sizeof(one)) < 0 && errno == EINTR) {}
+            reaper_.join();
+        }
+        // Timers still pending are cancelled with the ring, never run.
+        while (pending_head_) {
+            Node* node = pending_head_;
+            pending_head_ = node->next;
+            delete node;
+        }
+        teardown();
+    }
+
+    CUringTimerScheduler(const CUringTimerScheduler&) = delete;
+    CUringTimerScheduler& operator=(const CUringTimerScheduler&) = delete;
+
+    bool valid() const { return ring_fd_ >= 0; }
+
+    void schedule(unsigned int delay_ms, std::function<void()> func) override {
+        Node* node = new Node;
+        node->ts.tv_sec = delay_ms / 1000;
+        node->ts.tv_nsec = static_cast<long long>(delay_ms % 1000) * 1000000LL;
+        node->func = std::move(func);
+
+        track(node);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (io_uring_sqe* sqe = next_sqe_locked()) {
+                sqe->opcode = IORING_OP_TIMEOUT;
+                sqe->fd = -1;
+                sqe->addr = reinterpret_cast<uintptr_t>(&node->ts);
+                sqe->len = 1;
+                sqe->off = 0;  // pure timer, not waiting for completions
+                sqe->user_data = reinterpret_cast<uintptr_t>(node);
+                publish_locked();
+                return;
+            }
+        }
+        fall_back(node, delay_ms);
+    }
+
+    void flush() override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        submit_locked();
+    }
+
+    // Run func on the completion thread as soon as possible (on a
+    // CThreadTimerScheduler thread if the ring has failed).
+    void post(std::function<void()> func) {
+        Node* node = new Node;
+        node->func = std::move(func);
+
+        track(node);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (push_wakeup_locked(reinterpret_cast<uintptr_t>(node)) && submit_locked()) return;
+        }
+        // A wakeup left in the ring after a failed submit is never reaped.
+        fall_back(node, 0);
+    }
+
+    // Number of io_uring_enter() calls made to submit work.
+    unsigned long submit_calls() const { return submit_calls_.load(std::memory_order_relaxed); }
+    bool uses_msg_ring() const { return msg_ring_; }
+
+private:
+    struct Node {
+        __kernel_timespec ts{};
+        std::function<void()> func;
+        Node* prev = nullptr;
+        Node* next = nullptr;
+    };
+
+    static constexpr uint64_t kStopData = 1;    // stop_fd_ poll: stops the reaper
+    static constexpr uint64_t kIgnoreData = 2;  // sender-side CQE of MSG_RING
+
+    static int sys_setup(unsigned int entries, io_uring_params* p) {
+        return static_cast<int>(syscall(__NR_io_uring_setup, entries, p));
+    }
+    static int sys_enter(int fd, unsigned int to_submit, unsigned int min_complete, unsigned int flags) {
+        return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+    }
+    static int sys_register(int fd, unsigned int opcode, void* arg, unsigned int nr_args) {
+        return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+    }
+
+    bool setup(unsigned int entries) {
+        io_uring_params p;
+        std::memset(&p, 0, sizeof(p));
+        p.flags = IORING_SETUP_CQSIZE;
+        p.cq_entries = entries * 8;  // timers in flight outnumber one submission batch
+        ring_fd_ = sys_setup(entries, &p);
+        if (ring_fd_ < 0) return false;
+
+        sq_ring_size_ = p.sq_off.array + p.sq_entries * sizeof(unsigned int);
+        cq_ring_size_ = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+        single_mmap_ = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single_mmap_) {
+            sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+        }
+
+        sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        ring_fd_, IORING_OFF_SQ_RING);
+        if (sq_ring_ == MAP_FAILED) { sq_ring_ = nullptr; return false; }
+        if (single_mmap_) {
+            cq_ring_ = sq_ring_;
+        } else {
+            cq_ring_ = mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                            ring_fd_, IORING_OFF_CQ_RING);
+            if (cq_ring_ == MAP_FAILED) { cq_ring_ = nullptr; return false; }
+        }
+        sqes_size_ = p.sq_entries * sizeof(io_uring_sqe);
+        void* sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                          ring_fd_, IORING_OFF_SQES);
+        if (sqes == MAP_FAILED) return false;
+        sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+        char* sq = static_cast<char*>(sq_ring_);
+        sq_head_ = reinterpret_cast<unsigned int*>(sq + p.sq_off.head);
+        sq_tail_ = reinterpret_cast<unsigned int*>(sq + p.sq_off.tail);
+        sq_mask_ = *reinterpret_cast<unsigned int*>(sq + p.sq_off.ring_mask);
+        sq_entries_ = p.sq_entries;
+        unsigned int* sq_array = reinterpret_cast<unsigned int*>(sq + p.sq_off.array);
+        for (unsigned int i = 0; i < sq_entries_; ++i) sq_array[i] = i;
+        local_tail_ = *sq_tail_;
+
+        char* cq = static_cast<char*>(cq_ring_);
+        cq_head_ = reinterpret_cast<unsigned int*>(cq + p.cq_off.head);
+        cq_tail_ = reinterpret_cast<unsigned int*>(cq + p.cq_off.tail);
+        cq_mask_ = *reinterpret_cast<unsigned int*>(cq + p.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe*>(cq + p.cq_off.cqes);
+
+        msg_ring_ = probe_op(IORING_OP_MSG_RING);
+
+        // Armed now, while the ring works, so the destructor can always stop the reaper.
+        stop_fd_ = eventfd(0, EFD_CLOEXEC);
+        if (stop_fd_ < 0) return false;
+        io_uring_sqe* sqe = next_sqe_locked();
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->fd = stop_fd_;
+        sqe->poll_events = POLLIN;
+        sqe->user_data = kStopData;
+        publish_locked();
+        return submit_locked();
+    }
+
+    void teardown() {
+        if (sqes_) munmap(sqes_, sqes_size_);
+        if (cq_ring_ && cq_ring_ != sq_ring_) munmap(cq_ring_, cq_ring_size_);
+        if (sq_ring_) munmap(sq_ring_, sq_ring_size_);
+        if (ring_fd_ >= 0) close(ring_fd_);
+        if (stop_fd_ >= 0) close(stop_fd_);
+        stop_fd_ = -1;
+        sqes_ = nullptr;
+        sq_ring_ = cq_ring_ = nullptr;
+        ring_fd_ = -1;
+    }
+
+    bool probe_op(int op) {
+        const unsigned int nr_ops = 256;
+        size_t size = sizeof(io_uring_probe) + nr_ops * sizeof(io_uring_probe_op);
+        io_uring_probe* probe = static_cast<io_uring_probe*>(std::calloc(1, size));
+        if (!probe) return false;
+        bool supported = sys_register(ring_fd_, IORING_REGISTER_PROBE, probe, nr_ops) == 0
+                      && op <= probe->last_op
+                      && (probe->ops[op].flags & IO_URING_OP_SUPPORTED);
+        std::free(probe);
+        return supported;
+    }
+
+    void track(Node* node) {
+        std::lock_guard<std::mutex> lock(list_mutex_);
+        node->next = pending_head_;
+        if (pending_head_) pending_head_->prev = node;
+        pending_head_ = node;
+    }
+
+    void untrack(Node* node) {
+        std::lock_guard<std::mutex> lock(list_mutex_);
+        if (node->prev) node->prev->next = node->next;
+        else pending_head_ = node->next;
+        if (node->next) node->next->prev = node->prev;
+    }
+
+    // Runs a callback the ring could not take on the portable scheduler.
+    void fall_back(Node* node, unsigned int delay_ms) {
+        untrack(node);
+        std::function<void()> func = std::move(node->func);
+        delete node;
+        CThreadTimerScheduler::instance()->schedule(delay_ms, std::move(func));
+    }
+
+    // nullptr if the ring was never set up or is unusable.
+    io_uring_sqe* next_sqe_locked() {
+        if (ring_fd_ < 0 || broken_) return nullptr;
+        // Ring full: hand the queued batch to the kernel to make room.
+        while (local_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) >= sq_entries_) {
+            if (unsubmitted_ == 0 || !submit_locked()) return nullptr;
+        }
+        if (broken_) return nullptr;
+        io_uring_sqe* sqe = &sqes_[local_tail_ & sq_mask_];
+        std::memset(sqe, 0, sizeof(*sqe));
+        return sqe;
+    }
+
+    void publish_locked() {
+        ++local_tail_;
+        ++unsubmitted_;
+        __atomic_store_n(sq_tail_, local_tail_, __ATOMIC_RELEASE);
+    }
+
+    bool push_wakeup_locked(uint64_t data) {
+        io_uring_sqe* sqe = next_sqe_locked();
+        if (!sqe) return false;
+        if (msg_ring_) {
+            sqe->opcode = IORING_OP_MSG_RING;
+            sqe->fd = ring_fd_;  // target ring: our own completion thread
+            sqe->len = 0;        // res of the target CQE
+            sqe->off = data;     // user_data of the target CQE
+            sqe->user_data = kIgnoreData;
+        } else {
+            sqe->opcode = IORING_OP_NOP;
+            sqe->fd = -1;
+            sqe->user_data = data;
+        }
+        publish_locked();
+        return true;
+    }
+
+    // False once the ring is unusable; its entries are left for teardown.
+    bool submit_locked() {
+        while (unsubmitted_ > 0 && !broken_) {
+            int ret = sys_enter(ring_fd_, unsubmitted_, 0, 0);
+            submit_calls_.fetch_add(1, std::memory_order_relaxed);
+            if (ret > 0) {
+                unsubmitted_ -= static_cast<unsigned int>(ret);
+            } else if (ret < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+                broken_ = true;
+            } else {
+                std::this_thread::yield();  // CQ backpressure: let the reaper drain
+            }
+        }
+        return !broken_;
+    }
+
+    void reap_loop() {
+        bool exit = false;      // set by a destructor running in one of our callbacks
+        reaperExit_ = &exit;
+        for (;;) {
+            int ret = sys_enter(ring_fd_, 0, 1, IORING_ENTER_GETEVENTS);
+            if (ret < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) return;
+
+            unsigned int head = *cq_head_;
+            unsigned int tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+            while (head != tail) {
+                const io_uring_cqe& cqe = cqes_[head & cq_mask_];
+                uint64_t data = cqe.user_data;
+                int res = cqe.res;
+                __atomic_store_n(cq_head_, ++head, __ATOMIC_RELEASE);
+
+                if (data == kIgnoreData) continue;
+                if (data == kStopData) return;
+
+                Node* node = reinterpret_cast<Node*>(static_cast<uintptr_t>(data));
+                untrack(node);
+                if (res != -ECANCELED && node->func) node->func();
+                delete node;
+                if (exit) return;   // this object is gone
+            }
+        }
+    }
+
+    int ring_fd_ = -1;
+    int stop_fd_ = -1;              // eventfd the destructor writes to stop the reaper
+    bool single_mmap_ = false;
+    bool msg_ring_ = false;
+    void* sq_ring_ = nullptr;
+    void* cq_ring_ = nullptr;
+    size_t sq_ring_size_ = 0;
+    size_t cq_ring_size_ = 0;
+    size_t sqes_size_ = 0;
+    io_uring_sqe* sqes_ = nullptr;
+    io_uring_cqe* cqes_ = nullptr;
+    unsigned int* sq_head_ = nullptr;
+    unsigned int* sq_tail_ = nullptr;
+    unsigned int* cq_head_ = nullptr;
+    unsigned int* cq_tail_ = nullptr;
+    unsigned int sq_mask_ = 0;
+    unsigned int cq_mask_ = 0;
+    unsigned int sq_entries_ = 0;
+
+    std::mutex mutex_;              // guards the SQ
+    unsigned int local_tail_ = 0;
+    unsigned int unsubmitted_ = 0;
+    bool broken_ = false;           // a submit failed for good
+    std::mutex list_mutex_;         // guards the pending list
+    Node* pending_head_ = nullptr;
+    std::atomic<unsigned long> submit_calls_{0};
+    std::thread reaper_;
+    bool* reaperExit_ = nullptr;    // reaper thread only
+};
+
+// io_uring when the kernel allows it, the portable thread scheduler otherwise.
+inline std::shared_ptr<ITimerScheduler> make_timer_scheduler(unsigned int entries = 256) {
+    auto uring = std::make_shared<CUringTimerScheduler>(entries);
+    if (uring->valid()) return uring;
+    return CThreadTimerScheduler::instance();
+}
+
+// usage example
+/*
+CTimedEvent<int> onState;
+onState.set_scheduler(make_timer_scheduler());
+for (int i = 0; i < 100; ++i) {
+    onState.subscribe_with_delay([](int s) { std::cout << "late " << s << std::endl; }, 10 * i);
+}
+onState.trigger(1);   // 100 timers, one io_uring_enter()
+*/
+
+#endif
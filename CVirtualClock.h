@@ -0,0 +1,120 @@
+/**************************************************************
+
+DESCRIPTION
+
+	This file defines CVirtualTimerScheduler, a virtual-time
+	scheduler for CTimedEvent.
+
+	Nothing sleeps: time only moves when the owner calls advance(),
+	run_next() or run_until_idle(), which jump straight to the next
+	deadline and run the due callbacks on the calling thread. Timers
+	with the same deadline run in the order they were scheduled, so
+	tests and simulations are deterministic.
+
+**************************************************************/
+
+
+#ifndef __CVirtualClock_h__
+#define __CVirtualClock_h__
+
+#include "CTimedEvent.h"
+
+#include <algorithm>
+#include <limits>
+
+class CVirtualTimerScheduler : public ITimerScheduler {
+public:
+    explicit CVirtualTimerScheduler(uint64_t start_ms = 0) : now_(start_ms) {}
+
+    void schedule(unsigned int delay_ms, std::function<void()> func) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        timers_.push_back(Timer{now_ + delay_ms, nextSeq_++, std::move(func)});
+        std::push_heap(timers_.begin(), timers_.end(), Later());
+    }
+
+    uint64_t now_ms() const override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return now_;
+    }
+
+    uint64_t now_ns() const override { return now_ms() * 1000000; }
+
+    size_t pending() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return timers_.size();
+    }
+
+    // Jump to the earliest deadline and run that one timer.
+    bool run_next() {
+        return run_one(std::numeric_limits<uint64_t>::max());
+    }
+
+    // Run every timer due within ms from now, then leave the clock at now + ms.
+    size_t advance(uint64_t ms) {
+        uint64_t target;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            target = now_ + ms;
+        }
+        size_t count = 0;
+        while (run_one(target)) ++count;
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (now_ < target) now_ = target;
+        return count;
+    }
+
+    // Run until no timers remain (callbacks may schedule more), up to max_timers.
+    size_t run_until_idle(size_t max_timers = std::numeric_limits<size_t>::max()) {
+        size_t count = 0;
+        while (count < max_timers && run_next()) ++count;
+        return count;
+    }
+
+private:
+    struct Timer {
+        uint64_t deadline;
+        uint64_t seq;
+        std::function<void()> func;
+    };
+
+    // Min-heap on (deadline, seq)
+    struct Later {
+        bool operator()(const Timer& a, const Timer& b) const {
+            return a.deadline != b.deadline ? a.deadline > b.deadline : a.seq > b.seq;
+        }
+    };
+
+    bool run_one(uint64_t limit) {
+        std::function<void()> func;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (timers_.empty() || timers_.front().deadline > limit) return false;
+            std::pop_heap(timers_.begin(), timers_.end(), Later());
+            Timer& timer = timers_.back();
+            if (timer.deadline > now_) now_ = timer.deadline;
+            func = std::move(timer.func);
+            timers_.pop_back();
+        }
+        if (func) func();  // outside the lock: callbacks may schedule more timers
+        return true;
+    }
+
+    mutable std::mutex mutex_;
+    uint64_t now_;
+    uint64_t nextSeq_ = 0;
+    std::vector<Timer> timers_;
+};
+
+// usage example
+/*
+auto clock = std::make_shared<CVirtualTimerScheduler>();
+CTimedEvent<int> onRetry;
+onRetry.set_scheduler(clock);
+onRetry.subscribe_with_delay([](int n) { std::cout << "retry " << n << std::endl; }, 30000);
+
+onRetry.trigger(1);
+clock->advance(29999);   // nothing yet
+clock->advance(1);       // prints "retry 1", clock->now_ms() == 30000, no real sleep
+*/
+
+#endif
@@ -0,0 +1,328 @@
+/**************************************************************
+
+DESCRIPTION
+
+	This file defines CWatchdog, which detects hung handlers on
+	pool workers and delayed CTimedEvent threads.
+
+	Every watched thread owns a slot. The thread writes the start
+	time and the task name into its slot when a handler starts
+	and clears it when the handler returns; both are lock-free
+	stores. A monitor thread scans the slots. A handler running
+	past the deadline is flagged once and reported with its
+	worker and task names. If enabled, the report carries a stack
+	trace: the monitor signals the hung thread, which runs
+	backtrace() on itself.
+
+	A slot can also carry a compensation callback. CThreadPool
+	uses it to add a replacement worker, so one stuck subscriber
+	does not cost the pool a thread. When the stuck handler
+	finally returns, its worker retires and the pool shrinks back.
+
+**************************************************************/
+
+
+#ifndef __CWatchdog_h__
+#define __CWatchdog_h__
+
+#include "CThreadPool.h"
+#include "CTimedEvent.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <execinfo.h>
+#include <pthread.h>
+#include <signal.h>
+
+struct CWatchdogConfig {
+    std::chrono::milliseconds deadline{5000};       // handler time before it counts as hung
+    std::chrono::milliseconds check_interval{250};
+    bool capture_stacks = false;                    // signal the hung thread for a backtrace
+    int stack_signal = SIGURG;                      // reserved for the watchdog when capture_stacks is on
+    unsigned int max_compensations = 8;             // replacement workers alive at once
+};
+
+struct CHungReport {
+    std::string worker;
+    std::string task;
+    std::chrono::milliseconds running;
+    std::vector<std::string> stack;     // empty unless capture_stacks
+};
+
+class CWatchdog : public IPoolWatchdog {
+public:
+    using Reporter = std::function<void(const CHungReport&)>;
+
+    class Slot : public IPoolWatchdog::Worker {
+        friend class CWatchdog;
+    public:
+        // name must have static storage (a literal); it is read by the monitor.
+        void begin(const char* name) override {
+            task_.store(name ? name : "task", std::memory_order_relaxed);
+            start_.store(now_ns(), std::memory_order_release);
+        }
+
+        // Returns true if the handler was flagged hung and a replacement worker
+        // was started for it; the caller should then retire.
+        bool end() override {
+            start_.store(0, std::memory_order_seq_cst);
+            // A stack capture aimed at this thread may be about to signal it;
+            // let it finish so the thread is still alive when the signal lands.
+            if (capture_target().load(std::memory_order_seq_cst) == this) {
+                std::lock_guard<std::mutex> lock(capture_mutex());
+            }
+            return compensated_.exchange(false, std::memory_order_acq_rel);
+        }
+
+    private:
+        static constexpr int kMaxFrames = 48;
+
+        std::string worker_;
+        pthread_t thread_ = pthread_self();
+        std::function<void()> compensate_;
+        std::atomic<uint64_t> start_{0};            // 0 = idle
+        std::atomic<const char*> task_{nullptr};
+        uint64_t reportedStart_ = 0;                // monitor only
+        std::atomic<bool> compensated_{false};
+
+        void* frames_[kMaxFrames];
+        std::atomic<int> frameCount_{-1};           // set by the signal handler
+    };
+
+    explicit CWatchdog(CWatchdogConfig config = CWatchdogConfig(), Reporter reporter = nullptr)
+        : config_(config), reporter_(reporter ? std::move(reporter) : Reporter(&print_report)) {
+        if (config_.capture_stacks) install_handler(config_.stack_signal);
+        monitor_ = std::thread([this]() { run(); });
+    }
+
+    ~CWatchdog() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        cv_.notify_all();
+        monitor_.join();
+    }
+
+    CWatchdog(const CWatchdog&) = delete;
+    CWatchdog& operator=(const CWatchdog&) = delete;
+
+    // Registers the calling thread. compensate (optional) runs on the monitor
+    // thread, under the watchdog lock, when a handler in this slot hangs.
+    std::shared_ptr<Slot> attach(std::string worker, std::function<void()> compensate = nullptr) {
+        auto slot = std::make_shared<Slot>();
+        slot->worker_ = std::move(worker);
+        slot->compensate_ = std::move(compensate);
+        std::lock_guard<std::mutex> lock(mutex_);
+        slots_.push_back(slot);
+        return slot;
+    }
+
+    // After detach returns the slot's compensate callback will not run again.
+    void detach(const std::shared_ptr<Slot>& slot) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        slots_.erase(std::remove(slots_.begin(), slots_.end(), slot), slots_.end());
+        if (slot->compensated_.load(std::memory_order_relaxed)) --activeCompensations_;
+    }
+
+    // Watches one handler run on a thread that is not a long-lived worker.
+    class Scope {
+    public:
+        Scope(CWatchdog& watchdog, const char* worker, const char* task)
+            : watchdog_(watchdog), slot_(watchdog.attach(worker)) {
+            slot_->begin(task);
+        }
+        ~Scope() {
+            slot_->end();
+            watchdog_.detach(slot_);
+        }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    private:
+        CWatchdog& watchdog_;
+        std::shared_ptr<Slot> slot_;
+    };
+
+    std::shared_ptr<IPoolWatchdog::Worker> attach_worker(const char* name,
+                                                         std::function<void()> compensate) override {
+        return attach(name, std::move(compensate));
+    }
+
+    void detach_worker(const std::shared_ptr<IPoolWatchdog::Worker>& worker) override {
+        detach(std::static_pointer_cast<Slot>(worker));
+    }
+
+    // Called by a worker that retires after its compensated handler returned.
+    void compensation_done() override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (activeCompensations_ > 0) --activeCompensations_;
+    }
+
+    unsigned long hung() const { return hung_.load(std::memory_order_relaxed); }
+    unsigned long compensations() const { return compensations_.load(std::memory_order_relaxed); }
+
+private:
+    static uint64_t now_ns() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    static void print_report(const CHungReport& report) {
+        std::fprintf(stderr, "watchdog: %s hung in %s for %lld ms\n", report.worker.c_str(),
+                     report.task.c_str(), static_cast<long long>(report.running.count()));
+        for (const auto& frame : report.stack) std::fprintf(stderr, "    %s\n", frame.c_str());
+    }
+
+    static std::atomic<Slot*>& capture_target() {
+        static std::atomic<Slot*> target{nullptr};
+        return target;
+    }
+
+    // One capture at a time, across watchdogs.
+    static std::mutex& capture_mutex() {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    // Runs on the hung thread; only atomics and backtrace().
+    static void on_capture_signal(int) {
+        Slot* slot = capture_target().load(std::memory_order_acquire);
+        if (slot && pthread_equal(slot->thread_, pthread_self())) {
+            slot->frameCount_.store(backtrace(slot->frames_, Slot::kMaxFrames), std::memory_order_release);
+        }
+    }
+
+    static void install_handler(int signo) {
+        static std::once_flag once;
+        std::call_once(once, [signo]() {
+            void* warmup[1];
+            backtrace(warmup, 1);   // loads the unwinder now, not inside the handler
+            struct sigaction action = {};
+            action.sa_handler = &on_capture_signal;
+            sigemptyset(&action.sa_mask);
+            action.sa_flags = SA_RESTART;
+            sigaction(signo, &action, nullptr);
+        });
+    }
+
+    std::vector<std::string> capture(Slot& slot) {
+        std::lock_guard<std::mutex> lock(capture_mutex());
+        slot.frameCount_.store(-1, std::memory_order_relaxed);
+        capture_target().store(&slot, std::memory_order_seq_cst);
+        std::vector<std::string> stack;
+        // The handler may have returned since the scan, and a Scope's thread may
+        // be gone. Once the target is set, end() waits for this lock, so a
+        // handler still running here keeps its thread alive until we are done.
+        if (slot.start_.load(std::memory_order_seq_cst) != 0 &&
+            pthread_kill(slot.thread_, config_.stack_signal) == 0) {
+            for (int i = 0; i < 100 && slot.frameCount_.load(std::memory_order_acquire) < 0; ++i) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+        capture_target().store(nullptr, std::memory_order_release);
+        int count = slot.frameCount_.load(std::memory_order_acquire);
+        if (count > 0) {
+            char** symbols = backtrace_symbols(slot.frames_, count);
+            if (symbols) {
+                stack.assign(symbols, symbols + count);
+                std::free(symbols);
+            }
+        }
+        return stack;
+    }
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!cv_.wait_for(lock, config_.check_interval, [this]() { return stopping_; })) {
+            uint64_t now = now_ns();
+            uint64_t deadline = static_cast<uint64_t>(std::chrono::nanoseconds(config_.deadline).count());
+            std::vector<std::pair<std::shared_ptr<Slot>, CHungReport>> reports;
+            for (auto& slot : slots_) {
+                uint64_t start = slot->start_.load(std::memory_order_acquire);
+                if (start == 0 || start == slot->reportedStart_ || now - start < deadline) continue;
+                slot->reportedStart_ = start;   // once per hung invocation
+                hung_.fetch_add(1, std::memory_order_relaxed);
+                const char* task = slot->task_.load(std::memory_order_relaxed);
+                reports.emplace_back(slot, CHungReport{slot->worker_, task ? task : "",
+                    std::chrono::milliseconds((now - start) / 1000000), {}});
+                if (slot->compensate_ && activeCompensations_ < config_.max_compensations) {
+                    ++activeCompensations_;
+                    compensations_.fetch_add(1, std::memory_order_relaxed);
+                    slot->compensated_.store(true, std::memory_order_release);
+                    slot->compensate_();
+                }
+            }
+            lock.unlock();
+            for (auto& report : reports) {
+                if (config_.capture_stacks) report.second.stack = capture(*report.first);
+                reporter_(report.second);
+            }
+            lock.lock();
+        }
+    }
+
+    CWatchdogConfig config_;
+    Reporter reporter_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::vector<std::shared_ptr<Slot>> slots_;
+    unsigned int activeCompensations_ = 0;
+    bool stopping_ = false;
+    std::atomic<unsigned long> hung_{0};
+    std::atomic<unsigned long> compensations_{0};
+    std::thread monitor_;
+};
+
+// Wraps another timer scheduler so every delayed CTimedEvent callback runs
+// under a watchdog Scope.
+class CWatchedTimerScheduler : public ITimerScheduler {
+public:
+    CWatchedTimerScheduler(std::shared_ptr<CWatchdog> watchdog, const char* name,
+                           std::shared_ptr<ITimerScheduler> inner = CThreadTimerScheduler::instance())
+        : watchdog_(std::move(watchdog)), name_(name), inner_(std::move(inner)) {}
+
+    void schedule(unsigned int delay_ms, std::function<void()> func) override {
+        inner_->schedule(delay_ms, [watchdog = watchdog_, name = name_, func = std::move(func)]() {
+            CWatchdog::Scope scope(*watchdog, "timer", name);
+            func();
+        });
+    }
+
+    void flush() override { inner_->flush(); }
+    uint64_t now_ms() const override { return inner_->now_ms(); }
+    uint64_t now_ns() const override { return inner_->now_ns(); }
+
+private:
+    std::shared_ptr<CWatchdog> watchdog_;
+    const char* name_;
+    std::shared_ptr<ITimerScheduler> inner_;
+};
+
+// usage example
+/*
+CWatchdogConfig config;
+config.deadline = std::chrono::seconds(2);
+config.capture_stacks = true;
+auto watchdog = std::make_shared<CWatchdog>(config, [](const CHungReport& r) {
+    g_pLog->LogInfo(LOG_SYS, (r.worker + " stuck in " + r.task).c_str());
+});
+
+CThreadPool pool(4, watchdog);          // a hung task gets a replacement worker
+pool.submit([]() { plugin.OnStatus(); }, "plugin.OnStatus");
+
+CTimedEvent<std::string> onRetry;
+onRetry.set_scheduler(std::make_shared<CWatchedTimerScheduler>(watchdog, "onRetry"));
+*/
+
+#endif
@@ -16,6 +16,13 @@ DESCRIPTION
 #include <iostream>
 #include <memory>
 
+// Returned by handlers subscribed with subscribe_handler(); Handled stops
+// trigger_until() from calling the remaining subscribers.
+enum class EEventResult {
+    Continue,
+    Handled
+};
+
 template <typename... Args>
 class CSimpleEvent {
 public:
@@ -67,6 +74,7 @@ template <typename... Args>
 class CEvent : public std::enable_shared_from_this<CEvent<Args...>>  {
 public:
     using Callback = std::function<void(Args...)>;
+    using Handler = std::function<EEventResult(Args...)>;
 
     class Subscription {
         friend class CEvent; // Grant Event access to private members
@@ -96,6 +104,8 @@ public:
         // Disable copying (subscriptions are unique ownership)
         Subscription(const Subscription&) = delete;
         Subscription& operator=(const Subscription&) = delete;
+        // Id reported by trigger_until() when this subscriber handles the event
+        int id() const { return id_; }
     private:
         // Private constructor: Only Event can create Subscriptions
         Subscription(std::weak_ptr<CEvent> event, int id) //(Event* event, int id)
@@ -115,31 +125,63 @@ public:
         return Subscription(weakSelf, id); //Subscription(this, id);
     }
 
+    // Handler that can stop propagation in trigger_until()
+    Subscription subscribe_handler(Handler handler) {
+        std::weak_ptr<CEvent> weakSelf = this->shared_from_this();
+        int id = nextId_++;
+        callbacks_.emplace_back(CallbackEntry{id, std::move(handler)});
+        return Subscription(weakSelf, id);
+    }
+
     void trigger(Args... args) {
-        // Clean up inactive entries before processing
-        if (needsCleanup_) {
-            callbacks_.erase(
-                std::remove_if(callbacks_.begin(), callbacks_.end(),
-                               [](const CallbackEntry& entry) { return !entry.active; }),
-                callbacks_.end());
-            needsCleanup_ = false;
+        cleanup();
+
+        for (const auto& entry : callbacks_) {
+            if (entry.callback) entry.callback(args...);
+            else entry.handler(args...);
         }
+    }
+
+    // Calls subscribers in order until a handler returns Handled.
+    // Returns the id of that subscription, or -1 if nobody handled it.
+    int trigger_until(Args... args) {
+        cleanup();
 
         for (const auto& entry : callbacks_) {
-            entry.callback(args...);
+            if (entry.callback) {
+                entry.callback(args...);
+            } else if (entry.handler(args...) == EEventResult::Handled) {
+                return entry.id;
+            }
         }
+        return -1;
     }
 
 private:
     struct CallbackEntry {
         int id;
         Callback callback;
+        Handler handler;    // set instead of callback by subscribe_handler()
         bool active;// {true};// = true; //active flag
         //std::string info; //debug info
 
         CallbackEntry(int id, Callback callback, bool active = true)
             : id(id), callback(std::move(callback)), active(active) {}
+        CallbackEntry(int id, Handler handler, bool active = true)
+            : id(id), handler(std::move(handler)), active(active) {}
     };
+
+    // Clean up inactive entries before processing
+    void cleanup() {
+        if (needsCleanup_) {
+            callbacks_.erase(
+                std::remove_if(callbacks_.begin(), callbacks_.end(),
+                               [](const CallbackEntry& entry) { return !entry.active; }),
+                callbacks_.end());
+            needsCleanup_ = false;
+        }
+    }
+
     bool needsCleanup_ = false; //track cleanup state
     int nextId_ = 0;
     std::vector<CallbackEntry> callbacks_;
@@ -157,13 +199,221 @@ private:
 };
 
 
+#include "CEventStatsOps.h"
+
+#include <atomic>
 #include <mutex>
 #include <condition_variable>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <exception>
+#include <chrono>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+// Preallocated buffer for triggers that arrive while an event or a
+// subscription is paused. With keys, a trigger replaces the buffered one
+// with the same key in place (conflation); lookups use an open-addressing
+// index sized at reserve(), so push() never allocates for the buffer itself.
+template <typename T>
+class CPauseBuffer {
+public:
+    void reserve(size_t capacity, bool keyed) {
+        if (capacity == 0) capacity = 1;
+        if (slots_.size() != capacity) {
+            slots_.clear();
+            slots_.resize(capacity);
+            keys_.assign(capacity, 0);
+        }
+        keyed_ = keyed;
+        size_t indexSize = 2;
+        while (indexSize < 2 * capacity) indexSize <<= 1;
+        if (keyed_) index_.assign(indexSize, 0);
+        else index_.clear();
+        count_ = 0;
+    }
+
+    // Returns false (and buffers nothing) when full.
+    template <typename... U>
+    bool push(uint64_t key, U&&... parts) {
+        if (keyed_) {
+            size_t mask = index_.size() - 1;
+            size_t h = static_cast<size_t>(key * 0x9E3779B97F4A7C15ULL) & mask;
+            for (; index_[h] != 0; h = (h + 1) & mask) {
+                size_t slot = index_[h] - 1;
+                if (keys_[slot] == key) {
+                    slots_[slot].emplace(std::forward<U>(parts)...);
+                    return true;
+                }
+            }
+            if (count_ == slots_.size()) return false;
+            index_[h] = static_cast<uint32_t>(count_ + 1);
+        } else if (count_ == slots_.size()) {
+            return false;
+        }
+        keys_[count_] = key;
+        slots_[count_++].emplace(std::forward<U>(parts)...);
+        return true;
+    }
+
+    // Calls fn on each buffered value in arrival order, then empties the buffer.
+    template <typename Fn>
+    void drain(Fn fn) {
+        for (size_t i = 0; i < count_; ++i) {
+            fn(*slots_[i]);
+            slots_[i].reset();
+        }
+        count_ = 0;
+        std::fill(index_.begin(), index_.end(), 0);
+    }
+
+    bool empty() const { return count_ == 0; }
+    size_t size() const { return count_; }
+    size_t capacity() const { return slots_.size(); }
+    bool keyed() const { return keyed_; }
+
+private:
+    std::vector<std::optional<T>> slots_;
+    std::vector<uint64_t> keys_;
+    std::vector<uint32_t> index_;   // slot + 1, 0 = empty
+    size_t count_ = 0;
+    bool keyed_ = false;
+};
+
+// Groups CEventSafe triggers made on this thread into one delivery per event.
+// Triggers inside the scope are collected; at commit (or scope exit) each
+// event delivers its batch: batch subscribers get it once, others per item.
+// Nested scopes join the outermost one. Leaving the scope by an exception
+// discards the batch; trigger_until() is never deferred. A subscriber that
+// throws does not stop the other batches: commit() rethrows the first
+// exception once all are delivered, and scope exit swallows it, so call
+// commit() to see it.
+class CBatchScope {
+public:
+    struct IPending {
+        virtual ~IPending() = default;
+        virtual void deliver(bool dedup) = 0;
+        virtual size_t size() const = 0;
+        virtual void truncate(size_t n) = 0;
+    };
+
+    // dedup drops repeated identical triggers (for argument types with ==).
+    // A nested scope remembers how much the transaction held when it began.
+    explicit CBatchScope(bool dedup = false)
+        : outer_(current_ref()), owner_(outer_ == nullptr), dedup_(dedup),
+          exceptions_(std::uncaught_exceptions()) {
+        if (owner_) {
+            current_ref() = this;
+        } else {
+            mark_.reserve(outer_->pending_.size());
+            for (auto& pending : outer_->pending_) mark_.push_back(pending.second->size());
+        }
+    }
+
+    // Left by an exception, a scope discards what it collected: the owner
+    // the whole transaction, a nested scope only the triggers since it began.
+    ~CBatchScope() {
+        if (std::uncaught_exceptions() > exceptions_) {
+            if (owner_) cancel();
+            else rollback();
+        }
+        try {
+            commit();
+        } catch (...) {
+            // Every batch went out; only the subscriber's exception is lost.
+        }
+    }
+
+    CBatchScope(const CBatchScope&) = delete;
+    CBatchScope& operator=(const CBatchScope&) = delete;
+
+    // Delivers everything collected so far; later triggers are delivered at once.
+    // A nested scope's commit is a no-op: its triggers go with the outer batch.
+    void commit() {
+        if (!owner_ || current_ref() != this) return;
+        current_ref() = nullptr;
+        auto pending = std::move(pending_);
+        pending_.clear();
+        std::exception_ptr error;
+        for (auto& batch : pending) {
+            try {
+                batch.second->deliver(dedup_);
+            } catch (...) {
+                if (!error) error = std::current_exception();
+            }
+        }
+        if (error) std::rethrow_exception(error);
+    }
+
+    // Discards everything collected in the whole transaction.
+    void cancel() {
+        if (CBatchScope* scope = current_ref()) scope->pending_.clear();
+    }
+
+    static CBatchScope* current() { return current_ref(); }
+
+    // Used by events: the pending batch of event, created on first use. Keyed
+    // by the event's control block, which a destroyed event's batch keeps
+    // reserved, so a new event at the same address never finds it.
+    IPending* find(const std::weak_ptr<const void>& event) {
+        for (auto& pending : pending_) {
+            if (!pending.first.owner_before(event) && !event.owner_before(pending.first)) {
+                return pending.second.get();
+            }
+        }
+        return nullptr;
+    }
+
+    void add(std::weak_ptr<const void> event, std::unique_ptr<IPending> pending) {
+        pending_.emplace_back(std::move(event), std::move(pending));
+    }
+
+private:
+    static CBatchScope*& current_ref() {
+        thread_local CBatchScope* current = nullptr;
+        return current;
+    }
+
+    // Nested scope: truncates the transaction back to mark_.
+    void rollback() {
+        if (current_ref() != outer_) return;   // transaction already committed
+        auto& pending = outer_->pending_;
+        if (pending.size() > mark_.size()) pending.resize(mark_.size());
+        for (size_t i = 0; i < pending.size(); ++i) pending[i].second->truncate(mark_[i]);
+    }
+
+    CBatchScope* outer_;
+    bool owner_;
+    bool dedup_;
+    int exceptions_;
+    std::vector<std::pair<std::weak_ptr<const void>, std::unique_ptr<IPending>>> pending_;   // in first-trigger order
+    std::vector<size_t> mark_;      // nested scope: outer pending sizes at construction
+};
+
+template <typename T, typename = void>
+struct CIsEqualityComparable : std::false_type {};
+
+template <typename T>
+struct CIsEqualityComparable<T, std::void_t<decltype(std::declval<const T&>() == std::declval<const T&>())>>
+    : std::true_type {};
 
 template <typename... Args>
 class CEventSafe : public std::enable_shared_from_this<CEventSafe<Args...>> {
 public:
     using Callback = std::function<void(Args...)>;
+    using Handler = std::function<EEventResult(Args...)>;
+    using PauseKey = std::function<uint64_t(const std::decay_t<Args>&...)>;
+    using Batch = std::vector<std::tuple<std::decay_t<Args>...>>;
+    using BatchCallback = std::function<void(const Batch&)>;
 
     class Subscription {
         friend class CEventSafe;
@@ -191,6 +441,18 @@ public:
         Subscription(const Subscription&) = delete;
         Subscription& operator=(const Subscription&) = delete;
 
+        int id() const { return id_; }
+
+        // Buffers this subscriber's triggers until resume(); see CEventSafe::pause().
+        // trigger_until() passes a paused subscription over instead.
+        void pause(size_t capacity = 1024) {
+            if (auto event = event_.lock()) event->pause_subscription(id_, capacity);
+        }
+
+        void resume() {
+            if (auto event = event_.lock()) event->resume_subscription(id_);
+        }
+
     private:
         Subscription(std::weak_ptr<CEventSafe> event, int id)
             : event_(std::move(event)), id_(id) {}
@@ -205,10 +467,315 @@ public:
         int id = nextId_++;
         auto entry = std::make_shared<CallbackEntry>(id, std::move(callback));
         callbacks_.push_back(entry);
+        if (StatsRef stats = stats_ref()) stats.add_subscribers(1);
+        return Subscription(std::move(weakSelf), id);
+    }
+
+    // Handler that can stop propagation in trigger_until()
+    Subscription subscribe_handler(Handler handler) {
+        std::weak_ptr<CEventSafe> weakSelf = this->shared_from_this();
+        std::lock_guard<std::mutex> lock(mutex_);
+        int id = nextId_++;
+        auto entry = std::make_shared<CallbackEntry>(id, std::move(handler));
+        callbacks_.push_back(entry);
+        if (StatsRef stats = stats_ref()) stats.add_subscribers(1);
+        return Subscription(std::move(weakSelf), id);
+    }
+
+    // Receives all triggers of a CBatchScope at once (a single-item batch otherwise).
+    Subscription subscribe_batch(BatchCallback batch) {
+        std::weak_ptr<CEventSafe> weakSelf = this->shared_from_this();
+        std::lock_guard<std::mutex> lock(mutex_);
+        int id = nextId_++;
+        auto entry = std::make_shared<CallbackEntry>(id, std::move(batch));
+        callbacks_.push_back(entry);
+        if (StatsRef stats = stats_ref()) stats.add_subscribers(1);
         return Subscription(std::move(weakSelf), id);
     }
 
     void trigger(Args... args) {
+        if (CBatchScope::current() && collect(args...)) return;
+        if (paused_.load(std::memory_order_acquire) && buffer(args...)) return;   // resume() signals
+        StatsRef stats = stats_ref();
+        if (stats) stats.count_trigger();
+        for (auto& entry : snapshot()) {
+            if (entry->paused.load(std::memory_order_acquire) && buffer(*entry, args...)) continue;
+            uint64_t start = stats ? CEventStatsOps::now_ns() : 0;
+            invoke(*entry, args...);
+            if (stats) stats.record_latency(CEventStatsOps::now_ns() - start);
+        }
+        signal();
+    }
+
+    // Calls subscribers in order until a handler returns Handled.
+    // Returns the id of that subscription, or -1 if nobody handled it.
+    // The answer is needed now, so nothing is buffered: while the event is
+    // paused the trigger is dropped (counted in pause_dropped()) and -1
+    // returned, and paused subscriptions are passed over.
+    int trigger_until(Args... args) {
+        if (paused_.load(std::memory_order_acquire)) {
+            pauseDropped_.fetch_add(1, std::memory_order_relaxed);
+            return -1;
+        }
+        int handledBy = -1;
+        StatsRef stats = stats_ref();
+        if (stats) stats.count_trigger();
+        for (auto& entry : snapshot()) {
+            if (entry->paused.load(std::memory_order_acquire)) continue;
+            uint64_t start = stats ? CEventStatsOps::now_ns() : 0;
+            bool handled = invoke(*entry, args...);
+            if (stats) stats.record_latency(CEventStatsOps::now_ns() - start);
+            if (handled) {
+                handledBy = entry->id;
+                break;
+            }
+        }
+        signal();
+        return handledBy;
+    }
+
+    // Trigger count so far (it wraps), for wait(seen, ...). Read it before
+    // checking whatever the trigger announces, so no trigger is missed.
+    uint32_t sequence() const { return seq_.load(std::memory_order_acquire) >> 1; }
+
+    // Blocks until the event is triggered after this call (subscribers have
+    // run by then) or the timeout passes; false on timeout.
+    template <typename Rep, typename Period>
+    bool wait(std::chrono::duration<Rep, Period> timeout) {
+        return wait(sequence(), timeout);
+    }
+
+    // Blocks until sequence() differs from seen or the timeout passes.
+    template <typename Rep, typename Period>
+    bool wait(uint32_t seen, std::chrono::duration<Rep, Period> timeout) {
+        return wait_sequence(seen, std::chrono::steady_clock::now() +
+                             std::chrono::duration_cast<std::chrono::steady_clock::duration>(timeout));
+    }
+
+    template <typename Clock, typename Duration>
+    bool wait_until(std::chrono::time_point<Clock, Duration> deadline) {
+        return wait_until(sequence(), deadline);
+    }
+
+    template <typename Clock, typename Duration>
+    bool wait_until(uint32_t seen, std::chrono::time_point<Clock, Duration> deadline) {
+        return wait_sequence(seen, std::chrono::steady_clock::now() +
+                             std::chrono::duration_cast<std::chrono::steady_clock::duration>(deadline - Clock::now()));
+    }
+
+    // Publishes trigger counts, the subscriber count and handler latency to a
+    // shared-memory slot (include CEventStats.h to get one). nullptr detaches;
+    // the slot must outlive its use here.
+    template <typename Slot>
+    void set_stats(Slot* stats) {
+        static_assert(std::is_same<Slot, CEventStatsSlot>::value, "set_stats() takes a CEventStatsSlot");
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stats) {
+            stats->set_subscribers(std::count_if(callbacks_.begin(), callbacks_.end(),
+                [](const std::shared_ptr<CallbackEntry>& entry) { return entry->active.load(std::memory_order_relaxed); }));
+            statsOps_.store(CEventStatsOps::of<Slot>(), std::memory_order_relaxed);
+        }
+        stats_.store(stats, std::memory_order_release);
+    }
+
+    void set_stats(std::nullptr_t) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.store(nullptr, std::memory_order_release);
+    }
+
+    // Conflation key for paused delivery: while paused, a trigger whose key
+    // matches a buffered one replaces it. Takes effect at the next pause().
+    void set_pause_key(PauseKey key) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pauseKey_ = std::move(key);
+    }
+
+    // Stops delivery; triggers go into a buffer of capacity slots, allocated
+    // here. A full buffer drops further triggers (see pause_dropped()).
+    // Waiters wake when resume() delivers a buffered trigger, not before.
+    void pause(size_t capacity = 1024) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (paused_.load(std::memory_order_relaxed)) return;
+        pending_.reserve(capacity, pauseKey_ != nullptr);
+        paused_.store(true, std::memory_order_release);
+    }
+
+    // Delivers the buffered triggers in order, then resumes live delivery.
+    // Triggers arriving meanwhile are buffered too, so none overtakes the backlog.
+    // Not to be called from a subscriber of this event.
+    void resume() {
+        std::lock_guard<std::mutex> resumeLock(resumeMutex_);
+        for (;;) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (!paused_.load(std::memory_order_relaxed)) return;
+                if (pending_.empty()) {
+                    paused_.store(false, std::memory_order_release);
+                    return;
+                }
+                std::swap(pending_, draining_);
+                pending_.reserve(draining_.capacity(), draining_.keyed());
+            }
+            auto entries = snapshot();
+            // Counted and timed here, as trigger() returned before doing so.
+            StatsRef stats = stats_ref();
+            draining_.drain([this, &entries, stats](Stored& stored) {
+                if (stats) stats.count_trigger();
+                for (auto& entry : entries) {
+                    uint64_t start = stats ? CEventStatsOps::now_ns() : 0;
+                    if (deliver(entry, stored) && stats) stats.record_latency(CEventStatsOps::now_ns() - start);
+                }
+                signal();
+            });
+        }
+    }
+
+    bool paused() const { return paused_.load(std::memory_order_acquire); }
+    unsigned long pause_dropped() const { return pauseDropped_.load(std::memory_order_relaxed); }
+
+private:
+    using Stored = std::tuple<std::decay_t<Args>...>;
+
+    struct CallbackEntry {
+        int id;
+        Callback callback;
+        Handler handler;    // set instead of callback by subscribe_handler()
+        BatchCallback batch;    // or by subscribe_batch()
+        std::atomic<bool> active;   // cleared under mutex_; deliver() reads it without
+        std::atomic<bool> paused{false};
+        std::unique_ptr<CPauseBuffer<Stored>[]> pauseBuffers;  // [0] filling, [1] draining; guarded by mutex_
+
+        CallbackEntry(int id, Callback callback, bool active = true)
+            : id(id), callback(std::move(callback)), active(active) {}
+        CallbackEntry(int id, Handler handler, bool active = true)
+            : id(id), handler(std::move(handler)), active(active) {}
+        CallbackEntry(int id, BatchCallback batch, bool active = true)
+            : id(id), batch(std::move(batch)), active(active) {}
+    };
+
+    // Calls whichever callable the entry holds; true if a handler returned Handled.
+    bool invoke(CallbackEntry& entry, Args... args) {
+        if (entry.callback) {
+            entry.callback(args...);
+        } else if (entry.handler) {
+            return entry.handler(args...) == EEventResult::Handled;
+        } else {
+            entry.batch(Batch{Stored(args...)});
+        }
+        return false;
+    }
+
+    struct BatchPending : CBatchScope::IPending {
+        std::weak_ptr<CEventSafe> event;
+        Batch items;
+
+        void deliver(bool dedup) override {
+            if (auto self = event.lock()) self->deliver_batch(items, dedup);
+        }
+
+        size_t size() const override { return items.size(); }
+        void truncate(size_t n) override { if (n < items.size()) items.erase(items.begin() + n, items.end()); }
+    };
+
+    // Inside a CBatchScope: queue the trigger for commit.
+    bool collect(Args... args) {
+        CBatchScope* scope = CBatchScope::current();
+        if (!scope) return false;
+        std::weak_ptr<CEventSafe> self = this->weak_from_this();
+        if (self.expired()) return false;   // not owned by a shared_ptr: no key
+        auto* pending = static_cast<BatchPending*>(scope->find(self));
+        if (!pending) {
+            auto created = std::make_unique<BatchPending>();
+            created->event = self;
+            pending = created.get();
+            scope->add(std::move(self), std::move(created));
+        }
+        pending->items.emplace_back(args...);
+        return true;
+    }
+
+    static void remove_duplicates(Batch& items) {
+        if constexpr ((CIsEqualityComparable<std::decay_t<Args>>::value && ...)) {
+            size_t kept = 0;
+            for (size_t i = 0; i < items.size(); ++i) {
+                bool seen = false;
+                for (size_t j = 0; j < kept && !seen; ++j) seen = items[j] == items[i];
+                if (!seen) {
+                    if (kept != i) items[kept] = std::move(items[i]);
+                    ++kept;
+                }
+            }
+            items.resize(kept);
+        }
+    }
+
+    // Commit of a CBatchScope: each subscriber sees the whole batch before the next one does.
+    void deliver_batch(Batch& items, bool dedup) {
+        if (dedup) remove_duplicates(items);
+        if (items.empty()) return;
+        if (paused_.load(std::memory_order_acquire)) {
+            for (auto& item : items) std::apply([this](auto&... args) { trigger(args...); }, item);
+            return;
+        }
+        StatsRef stats = stats_ref();
+        for (size_t i = 0; stats && i < items.size(); ++i) stats.count_trigger();
+        for (auto& entry : snapshot()) {
+            uint64_t start = stats ? CEventStatsOps::now_ns() : 0;
+            if (entry->batch && !entry->paused.load(std::memory_order_acquire)) {
+                entry->batch(items);
+            } else {
+                for (auto& item : items) deliver(entry, item);
+            }
+            if (stats) stats.record_latency(CEventStatsOps::now_ns() - start);
+        }
+        signal();
+    }
+
+    // seq_ counts triggers in steps of 2; bit 0 is set while a thread may be
+    // waiting. A trigger is one fetch_add and makes no system call unless the
+    // bit was set, in which case it clears it and wakes every waiter.
+    void signal() {
+        uint32_t previous = seq_.fetch_add(2, std::memory_order_acq_rel);
+        if (!(previous & 1)) return;
+#ifdef __linux__
+        seq_.fetch_and(~1u, std::memory_order_acq_rel);
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&seq_), FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+#else
+        std::lock_guard<std::mutex> lock(waitMutex_);
+        seq_.fetch_and(~1u, std::memory_order_acq_rel);
+        waitCv_.notify_all();
+#endif
+    }
+
+    bool wait_sequence(uint32_t seen, std::chrono::steady_clock::time_point deadline) {
+#ifdef __linux__
+        static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "futex word must be a plain uint32_t");
+        for (;;) {
+            uint32_t current = seq_.load(std::memory_order_acquire);
+            if ((current >> 1) != seen) return true;
+            if (!(current & 1) && !seq_.compare_exchange_weak(current, current | 1, std::memory_order_acq_rel)) {
+                continue;
+            }
+            auto left = deadline - std::chrono::steady_clock::now();
+            if (left <= std::chrono::steady_clock::duration::zero()) return false;
+            auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(left).count();
+            timespec timeout{static_cast<time_t>(ns / 1000000000), static_cast<long>(ns % 1000000000)};
+            // Returns at once if a trigger changed the word since the load above.
+            syscall(SYS_futex, reinterpret_cast<uint32_t*>(&seq_), FUTEX_WAIT_PRIVATE, current | 1, &timeout, nullptr, 0);
+        }
+#else
+        std::unique_lock<std::mutex> lock(waitMutex_);
+        for (;;) {
+            uint32_t current = seq_.fetch_or(1, std::memory_order_acq_rel);
+            if ((current >> 1) != seen) return true;
+            if (waitCv_.wait_until(lock, deadline) == std::cv_status::timeout) {
+                return (seq_.load(std::memory_order_acquire) >> 1) != seen;
+            }
+        }
+#endif
+    }
+
+    std::vector<std::shared_ptr<CallbackEntry>> snapshot() {
         std::vector<std::shared_ptr<CallbackEntry>> activeEntries;
         {
             std::lock_guard<std::mutex> lock(mutex_);
@@ -228,31 +795,107 @@ public:
                 }
             }
         }
+        return activeEntries;
+    }
 
-        for (auto& entry : activeEntries) {
-            entry->callback(args...);
+    // Paused path: copy the arguments into the buffer; false if no longer paused.
+    bool buffer(Args... args) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!paused_.load(std::memory_order_relaxed)) return false;
+        uint64_t key = pending_.keyed() && pauseKey_ ? pauseKey_(args...) : 0;
+        if (!pending_.push(key, args...)) pauseDropped_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    bool buffer(CallbackEntry& entry, Args... args) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!entry.paused.load(std::memory_order_relaxed)) return false;
+        CPauseBuffer<Stored>& pending = entry.pauseBuffers[0];
+        uint64_t key = pending.keyed() && pauseKey_ ? pauseKey_(args...) : 0;
+        if (!pending.push(key, args...)) pauseDropped_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Returns true if the subscriber ran (rather than being gone or buffering it).
+    bool deliver(const std::shared_ptr<CallbackEntry>& entry, Stored& stored) {
+        return std::apply([this, &entry](auto&... args) {
+            if (!entry->active.load(std::memory_order_acquire)) return false;
+            if (entry->paused.load(std::memory_order_acquire) && buffer(*entry, args...)) return false;
+            invoke(*entry, args...);
+            return true;
+        }, stored);
+    }
+
+    std::shared_ptr<CallbackEntry> find_locked(int id) {
+        auto it = std::find_if(callbacks_.begin(), callbacks_.end(),
+            [id](const std::shared_ptr<CallbackEntry>& entry) { return entry->id == id; });
+        return it != callbacks_.end() ? *it : nullptr;
+    }
+
+    void pause_subscription(int id, size_t capacity) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto entry = find_locked(id);
+        if (!entry || entry->paused.load(std::memory_order_relaxed)) return;
+        if (!entry->pauseBuffers) entry->pauseBuffers.reset(new CPauseBuffer<Stored>[2]);
+        entry->pauseBuffers[0].reserve(capacity, pauseKey_ != nullptr);
+        entry->paused.store(true, std::memory_order_release);
+    }
+
+    void resume_subscription(int id) {
+        std::lock_guard<std::mutex> resumeLock(resumeMutex_);
+        for (;;) {
+            std::shared_ptr<CallbackEntry> entry;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                entry = find_locked(id);
+                if (!entry || !entry->paused.load(std::memory_order_relaxed)) return;
+                CPauseBuffer<Stored>* buffers = entry->pauseBuffers.get();
+                if (buffers[0].empty()) {
+                    entry->paused.store(false, std::memory_order_release);
+                    return;
+                }
+                std::swap(buffers[0], buffers[1]);
+                buffers[0].reserve(buffers[1].capacity(), buffers[1].keyed());
+            }
+            // trigger() counted these; their handler time is recorded here.
+            StatsRef stats = stats_ref();
+            entry->pauseBuffers[1].drain([this, &entry, stats](Stored& stored) {
+                std::apply([this, &entry, stats](auto&... args) {
+                    if (!entry->active.load(std::memory_order_acquire)) return;
+                    uint64_t start = stats ? CEventStatsOps::now_ns() : 0;
+                    invoke(*entry, args...);
+                    if (stats) stats.record_latency(CEventStatsOps::now_ns() - start);
+                }, stored);
+            });
         }
     }
 
-private:
-    struct CallbackEntry {
-        int id;
-        Callback callback;
-        bool active;
+    // The attached stats slot, if any, with the ops to update it.
+    struct StatsRef {
+        CEventStatsSlot* slot;
+        const CEventStatsOps* ops;
 
-        CallbackEntry(int id, Callback callback, bool active = true)
-            : id(id), callback(std::move(callback)), active(active) {}
+        explicit operator bool() const { return slot != nullptr; }
+        void count_trigger() const { ops->count_trigger(slot); }
+        void record_latency(uint64_t ns) const { ops->record_latency(slot, ns); }
+        void add_subscribers(int64_t delta) const { ops->add_subscribers(slot, delta); }
     };
 
+    StatsRef stats_ref() const {
+        CEventStatsSlot* slot = stats_.load(std::memory_order_acquire);
+        return StatsRef{slot, slot ? statsOps_.load(std::memory_order_relaxed) : nullptr};
+    }
+
     void unsubscribe(int id) {
         std::lock_guard<std::mutex> lock(mutex_);
         auto it = std::find_if(callbacks_.begin(), callbacks_.end(),
             [id](const std::shared_ptr<CallbackEntry>& entry) {
                 return entry->id == id;
             });
-        if (it != callbacks_.end()) {
-            (*it)->active = false;
+        if (it != callbacks_.end() && (*it)->active) {
+            (*it)->active.store(false, std::memory_order_release);
             needsCleanup_ = true;
+            if (StatsRef stats = stats_ref()) stats.add_subscribers(-1);
         }
     }
 
@@ -260,6 +903,21 @@ private:
     bool needsCleanup_ = false;
     int nextId_ = 0;
     std::vector<std::shared_ptr<CallbackEntry>> callbacks_;
+    std::atomic<CEventStatsSlot*> stats_{nullptr};  // written under mutex_, read lock-free by trigger
+    std::atomic<const CEventStatsOps*> statsOps_{nullptr};  // set before stats_ is published
+
+    std::mutex resumeMutex_;                        // one resume at a time; taken before mutex_
+    std::atomic<bool> paused_{false};
+    PauseKey pauseKey_;
+    CPauseBuffer<Stored> pending_;                  // guarded by mutex_
+    CPauseBuffer<Stored> draining_;                 // owned by the resuming thread
+    std::atomic<unsigned long> pauseDropped_{0};
+
+    std::atomic<uint32_t> seq_{0};                  // see signal()
+#ifndef __linux__
+    std::mutex waitMutex_;
+    std::condition_variable waitCv_;
+#endif
 };
 
 // usage example
@@ -0,0 +1,171 @@
+/**************************************************************
+
+DESCRIPTION
+
+	eventtop: live, top-like view of the event statistics a
+	process publishes through CEventStatsRegion.
+
+	It maps the region read-only and never takes a lock the
+	publishing process could see. Rates are per second, computed
+	from two reads one refresh apart.
+
+	usage: eventtop [-i interval_ms] [-n iterations] [-s sort] region
+	       sort: rate (default), calls, p99, depth, drops, name
+	e.g.   eventtop /devmon_events
+
+**************************************************************/
+
+
+#include "../CEventStats.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+struct Row {
+    CEventStatsSnapshot snap;
+    double trigger_rate;
+    double call_rate;
+    double drop_rate;
+    uint64_t p50_ns;
+    uint64_t p99_ns;
+};
+
+void print_usage() {
+    std::fprintf(stderr, "usage: eventtop [-i interval_ms] [-n iterations] [-s rate|calls|p99|depth|drops|name] region\n");
+}
+
+const char* kind_name(EStatsKind kind) {
+    switch (kind) {
+    case EStatsKind::Dispatcher: return "disp";
+    case EStatsKind::Subscriber: return "sub";
+    case EStatsKind::Timer: return "tmr";   // latency columns show timer lateness
+    default: return "evt";
+    }
+}
+
+std::string format_ns(uint64_t ns) {
+    char buf[32];
+    if (ns == 0) std::snprintf(buf, sizeof(buf), "-");
+    else if (ns < 1000) std::snprintf(buf, sizeof(buf), "%lluns", static_cast<unsigned long long>(ns));
+    else if (ns < 1000000) std::snprintf(buf, sizeof(buf), "%.1fus", ns / 1e3);
+    else if (ns < 1000000000) std::snprintf(buf, sizeof(buf), "%.1fms", ns / 1e6);
+    else std::snprintf(buf, sizeof(buf), "%.1fs", ns / 1e9);
+    return buf;
+}
+
+// Latency percentiles over the last interval only, from the histogram delta.
+CEventStatsSnapshot interval_latency(const CEventStatsSnapshot& now, const CEventStatsSnapshot* before) {
+    CEventStatsSnapshot delta = now;
+    if (before) {
+        for (size_t b = 0; b < CEventStatsSnapshot::kLatencyBuckets; ++b) {
+            delta.latency[b] = now.latency[b] >= before->latency[b] ? now.latency[b] - before->latency[b] : 0;
+        }
+    }
+    return delta;
+}
+
+double rate(uint64_t now, uint64_t before, double seconds) {
+    return now >= before && seconds > 0 ? static_cast<double>(now - before) / seconds : 0;
+}
+
+}
+
+int main(int argc, char** argv) {
+    unsigned int interval_ms = 1000;
+    long iterations = -1;
+    std::string sort = "rate";
+    const char* region_name = nullptr;
+
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "-i") && i + 1 < argc) interval_ms = static_cast<unsigned int>(std::atoi(argv[++i]));
+        else if (!std::strcmp(argv[i], "-n") && i + 1 < argc) iterations = std::atol(argv[++i]);
+        else if (!std::strcmp(argv[i], "-s") && i + 1 < argc) sort = argv[++i];
+        else if (argv[i][0] != '-') region_name = argv[i];
+        else {
+            print_usage();
+            return 2;
+        }
+    }
+    if (!region_name || interval_ms == 0) {
+        print_usage();
+        return 2;
+    }
+
+    auto region = CEventStatsRegion::open(region_name);
+    if (!region) {
+        std::fprintf(stderr, "eventtop: cannot open stats region %s\n", region_name);
+        return 1;
+    }
+
+    // Previous reads, keyed by slot index and name so a reused slot starts afresh.
+    std::unordered_map<std::string, CEventStatsSnapshot> previous;
+    auto previous_time = std::chrono::steady_clock::now();
+    bool interactive = iterations < 0;
+
+    for (long round = 0; iterations < 0 || round <= iterations; ++round) {
+        auto now_time = std::chrono::steady_clock::now();
+        double seconds = std::chrono::duration<double>(now_time - previous_time).count();
+        previous_time = now_time;
+
+        std::vector<Row> rows;
+        std::unordered_map<std::string, CEventStatsSnapshot> current;
+        for (uint32_t i = 0; i < region->slot_count(); ++i) {
+            const CEventStatsSlot& slot = region->slot(i);
+            if (!slot.live()) continue;
+            CEventStatsSnapshot snap = slot.read();
+            std::string key = std::to_string(i) + ":" + snap.name;
+            auto it = previous.find(key);
+            const CEventStatsSnapshot* before = it != previous.end() ? &it->second : nullptr;
+            CEventStatsSnapshot window = interval_latency(snap, before);
+            rows.push_back(Row{snap,
+                               before ? rate(snap.triggers, before->triggers, seconds) : 0,
+                               before ? rate(snap.calls, before->calls, seconds) : 0,
+                               before ? rate(snap.drops, before->drops, seconds) : 0,
+                               window.latency_quantile_ns(0.50),
+                               window.latency_quantile_ns(0.99)});
+            current.emplace(std::move(key), snap);
+        }
+        previous.swap(current);
+
+        std::sort(rows.begin(), rows.end(), [&sort](const Row& a, const Row& b) {
+            if (sort == "calls") return a.call_rate > b.call_rate;
+            if (sort == "p99") return a.p99_ns > b.p99_ns;
+            if (sort == "depth") return a.snap.queue_depth > b.snap.queue_depth;
+            if (sort == "drops") return a.drop_rate > b.drop_rate;
+            if (sort == "name") return std::strcmp(a.snap.name, b.snap.name) < 0;
+            return a.trigger_rate > b.trigger_rate;
+        });
+
+        if (round > 0) {
+            if (interactive) std::printf("\033[H\033[2J");
+            std::printf("eventtop %s  %zu live / %u slots  every %ums\n\n",
+                        region_name, rows.size(), region->slot_count(), interval_ms);
+            std::printf("%-32s %4s %10s %10s %12s %6s %8s %8s %8s\n",
+                        "NAME", "KIND", "TRIG/s", "CALLS/s", "TOTAL", "SUBS", "DEPTH", "DROP/s", "P50/P99");
+            for (const Row& row : rows) {
+                std::string latency = format_ns(row.p50_ns) + "/" + format_ns(row.p99_ns);
+                std::printf("%-32.32s %4s %10.0f %10.0f %12llu %6lld %8lld %8.0f %s\n",
+                            row.snap.name,
+                            kind_name(row.snap.kind),
+                            row.trigger_rate, row.call_rate,
+                            static_cast<unsigned long long>(row.snap.triggers),
+                            static_cast<long long>(row.snap.subscribers),
+                            static_cast<long long>(row.snap.queue_depth),
+                            row.drop_rate, latency.c_str());
+            }
+            std::fflush(stdout);
+        }
+        if (iterations >= 0 && round == iterations) break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(interval_ms));
+    }
+    return 0;
+}